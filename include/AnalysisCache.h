@@ -0,0 +1,83 @@
+//===- AnalysisCache.h - Cached per-function checker output -----*- C++ -*-===//
+//
+// Most functions do not change between two runs over the same code base.
+// AnalysisCache remembers what each checker printed for each function, keyed
+// by a hash of the checker and the function's fingerprint, so unchanged
+// functions do not have to be checked again.
+//
+// The cache file is mapped into memory and searched in place:
+//
+//   Header   magic, version, number of entries, size of the text area
+//   Entries  { key, offset, length }, sorted by key
+//   Text     the output of all entries, back to back
+//
+// Integers are stored in host byte order.  Most functions produce no output,
+// so most entries take 16 bytes.
+//
+// A save keeps only the entries looked up or inserted during the run; keys of
+// functions that changed or are no longer checked are dropped, so the file
+// stays the size of one run's results.  Runs over different sets of modules
+// should therefore use different cache files.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_ANALYSISCACHE_H
+#define _PERFEVO_ANALYSISCACHE_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/DataTypes.h"
+#include "llvm/System/Mutex.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class AnalysisCache {
+  struct Entry {
+    uint64_t Key;
+    uint32_t Offset;
+    uint32_t Length;
+  };
+
+  std::string Path;
+
+  // The cache file as it was when the run started.
+  const char *Map;
+  size_t MapSize;
+  const Entry *Entries;
+  uint32_t NumEntries;
+  const char *Text;
+
+  // Results computed during this run, and which of the old entries were
+  // looked up.  Guarded by Lock.
+  std::map<uint64_t, std::string> Added;
+  mutable std::vector<bool> Used;
+  mutable uint32_t NumUsed;
+  mutable llvm::sys::Mutex Lock;
+
+  void open();
+  static bool keyLess(const Entry &E, uint64_t Key) { return E.Key < Key; }
+
+  AnalysisCache(const AnalysisCache &);        // DO NOT IMPLEMENT
+  void operator=(const AnalysisCache &);       // DO NOT IMPLEMENT
+public:
+  /// AnalysisCache - Use the cache stored in \p Path.  A missing or
+  /// unreadable file is treated as an empty cache.
+  explicit AnalysisCache(llvm::StringRef Path);
+  ~AnalysisCache();
+
+  /// lookup - Find the output stored under \p Key.  The text stays valid
+  /// for the lifetime of the cache.
+  bool lookup(uint64_t Key, llvm::StringRef &Output) const;
+
+  /// insert - Remember the output for \p Key.  Safe to call from several
+  /// threads at once.
+  void insert(uint64_t Key, llvm::StringRef Output);
+
+  /// save - Write the old entries looked up and everything inserted since
+  /// back to the cache file, replacing it atomically.  Returns false and
+  /// sets \p ErrMsg on failure.
+  bool save(std::string &ErrMsg);
+};
+
+#endif  /* _PERFEVO_ANALYSISCACHE_H */
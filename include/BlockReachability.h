@@ -0,0 +1,60 @@
+//===- BlockReachability.h - Bit-vector CFG reachability --------*- C++ -*-===//
+//
+// Some checkers look for one use of a value followed by another, e.g. a
+// string truncated with SetLength(0) and then appended to.  BlockReachability
+// numbers the basic blocks of a function densely, keeps the successor lists
+// as numbers and remembers, per value asked about, the blocks holding its
+// uses.  Searches then walk the CFG with a bit vector as the visited set and
+// only look inside blocks known to hold a use, so each search is linear in
+// the size of the CFG.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_BLOCKREACHABILITY_H
+#define _PERFEVO_BLOCKREACHABILITY_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Instruction;
+class Value;
+}
+
+class BlockReachability {
+  std::vector<llvm::BasicBlock*> Blocks;
+  llvm::DenseMap<const llvm::BasicBlock*, unsigned> Numbers;
+  std::vector<llvm::SmallVector<unsigned, 2> > Succs;
+  // Value -> the blocks holding one of its uses.
+  llvm::DenseMap<const llvm::Value*, llvm::BitVector> UseBlocks;
+public:
+  explicit BlockReachability(llvm::Function &F);
+
+  unsigned size() const { return Blocks.size(); }
+  llvm::BasicBlock *getBlock(unsigned N) const { return Blocks[N]; }
+  unsigned getNumber(const llvm::BasicBlock *BB) const {
+    return Numbers.find(BB)->second;
+  }
+  const llvm::SmallVector<unsigned, 2> &getSuccessors(unsigned N) const {
+    return Succs[N];
+  }
+
+  /// getUseBlocks - Return the blocks holding an instruction that uses V.
+  /// Computed the first time V is asked about.
+  const llvm::BitVector &getUseBlocks(const llvm::Value *V);
+
+  /// findNextUses - Add to \p Uses the first instruction using \p V on every
+  /// path leaving \p I.  Paths end at the first use; blocks in \p Skip are
+  /// not entered, and every block is looked at once, so a use reached along
+  /// several paths is added once.
+  void findNextUses(llvm::Instruction *I, const llvm::Value *V,
+                    const llvm::BitVector *Skip,
+                    llvm::SmallVectorImpl<llvm::Instruction*> &Uses);
+};
+
+#endif  /* _PERFEVO_BLOCKREACHABILITY_H */
@@ -0,0 +1,73 @@
+//===- CallGraphSummary.h - Bottom-up expensive call summaries --*- C++ -*-===//
+//
+// A loop that calls a helper that calls a helper that removes a child is as
+// slow as a loop that removes the child itself, but only the latter shows up
+// inside a loop of the function being checked.  CallGraphSummary walks the
+// strongly connected components of the call graph bottom-up and records, for
+// every defined function, whether it reaches a call of an expensive function,
+// one whose name matches a CalleeMatcher, together with the call that starts a
+// shortest known chain to it.  Each function and call is looked at a constant
+// number of times, so building the summaries is linear in the call graph.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_CALLGRAPHSUMMARY_H
+#define _PERFEVO_CALLGRAPHSUMMARY_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <vector>
+
+namespace llvm {
+class Function;
+class Instruction;
+class Module;
+}
+
+class CallSiteIndex;
+class CalleeMatcher;
+
+class CallGraphSummary {
+public:
+  struct Summary {
+    /// Witness - The call in the function that starts the chain: a call of
+    /// an expensive function, or of a function with a summary.
+    llvm::Instruction *Witness;
+    /// Pattern - The ID of the pattern the expensive function matched.
+    unsigned Pattern;
+    /// Depth - The number of calls in the chain.
+    unsigned Depth;
+
+    Summary() : Witness(0), Pattern(0), Depth(0) {}
+  };
+
+private:
+  const CallSiteIndex *CallSites;
+  const CalleeMatcher *Expensive;
+  // Function -> pattern ID + 1 if its name matches, 0 if not.
+  llvm::DenseMap<const llvm::Function*, unsigned> Matched;
+  llvm::DenseMap<const llvm::Function*, Summary> Summaries;
+
+  unsigned getMatch(const llvm::Function *F);
+  void summarize(const std::vector<const llvm::Function*> &SCC);
+public:
+  CallGraphSummary() : CallSites(0), Expensive(0) {}
+
+  /// build - Summarize every defined function of M, using the calls in
+  /// CallSites.  A function whose name Expensive matches is an expensive
+  /// operation and gets no summary of its own.
+  void build(llvm::Module &M, const CallSiteIndex &CallSites,
+             const CalleeMatcher &Expensive);
+
+  /// getSummary - Return the summary of F, or null if F reaches no
+  /// expensive function.
+  const Summary *getSummary(const llvm::Function *F) const;
+
+  /// getWitnessPath - Append the calls of the chain from F to the expensive
+  /// function to Path, F's own call first.
+  void getWitnessPath(const llvm::Function *F,
+                      llvm::SmallVectorImpl<llvm::Instruction*> &Path) const;
+};
+
+#endif  /* _PERFEVO_CALLGRAPHSUMMARY_H */
@@ -0,0 +1,69 @@
+//===- CallSiteIndex.h - Module-wide callee to call site map ----*- C++ -*-===//
+//
+// Many checkers ask which calls go to a particular function, in the module or
+// in the function being checked.  CallSiteIndex walks the module once and
+// records every call and invoke under the function it calls, looking through
+// pointer casts and aliases, so such questions cost a hash lookup instead of
+// a walk over the function.  The index is built before any function is
+// checked and only read afterwards, so it may be queried from several threads
+// at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_CALLSITEINDEX_H
+#define _PERFEVO_CALLSITEINDEX_H
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <vector>
+
+namespace llvm {
+class Function;
+class Instruction;
+class Module;
+}
+
+class CallSiteIndex {
+public:
+  /// CallList - Calls and invokes, in module order.
+  typedef std::vector<llvm::Instruction*> CallList;
+  /// CalleeMap - The calls made by one function, by callee.
+  typedef llvm::DenseMap<const llvm::Function*, CallList> CalleeMap;
+
+private:
+  // Callee -> all of its call sites.
+  CalleeMap Callers;
+  // Caller -> the calls it makes.
+  llvm::DenseMap<const llvm::Function*, CalleeMap> Calls;
+  // Returned when there is nothing to return.
+  CallList NoCalls;
+  CalleeMap NoCallees;
+
+public:
+  /// getCallee - Return the function \p I calls, looking through pointer
+  /// casts and aliases, or null if \p I is not a call or invoke or the
+  /// callee is not known.
+  static const llvm::Function *getCallee(const llvm::Instruction *I);
+
+  /// build - Index all calls in \p M, replacing what was indexed before.
+  void build(llvm::Module &M);
+  void clear();
+
+  /// getCallSites - All calls to \p Callee in the module.
+  const CallList &getCallSites(const llvm::Function *Callee) const;
+
+  /// getCallSites - The calls to \p Callee made by \p Caller.
+  const CallList &getCallSites(const llvm::Function *Caller,
+                               const llvm::Function *Callee) const;
+
+  /// getCallees - The calls made by \p Caller, by callee.
+  const CalleeMap &getCallees(const llvm::Function *Caller) const;
+
+  /// hasCallSite - Return true if \p Caller calls \p Callee.
+  bool hasCallSite(const llvm::Function *Caller,
+                   const llvm::Function *Callee) const {
+    return !getCallSites(Caller, Callee).empty();
+  }
+};
+
+#endif  /* _PERFEVO_CALLSITEINDEX_H */
@@ -0,0 +1,60 @@
+//===- CalleeMatcher.h - Multi-pattern substring matcher --------*- C++ -*-===//
+//
+// Checkers select the calls they look at by substrings of the callee's name,
+// e.g. "apr_stat" or "startTransaction".  CalleeMatcher compiles all of those
+// substrings into one Aho-Corasick automaton, so a name is classified against
+// every pattern in a single pass over its characters.  Each pattern carries an
+// ID, usually the index of the checker it belongs to, and matching a name
+// yields the set of IDs whose patterns occur in it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_CALLEEMATCHER_H
+#define _PERFEVO_CALLEEMATCHER_H
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class BitVector;
+}
+
+class CalleeMatcher {
+  struct State {
+    // Transitions, sorted by character.
+    std::vector<std::pair<unsigned char, unsigned> > Next;
+    // The longest proper suffix of this state that is also a state.
+    unsigned Fail;
+    // IDs of the patterns ending here, including those of the fail states.
+    llvm::SmallVector<unsigned, 1> IDs;
+
+    State() : Fail(0) {}
+    unsigned getNext(unsigned char C) const;
+  };
+
+  // State 0 is the root.
+  std::vector<State> States;
+  unsigned NumIDs;
+  bool Compiled;
+public:
+  CalleeMatcher();
+
+  /// add - Report \p ID for every name containing \p Pattern.  The pattern
+  /// takes effect at the next compile.
+  void add(llvm::StringRef Pattern, unsigned ID);
+  void clear();
+
+  /// compile - Link the patterns added so far into the automaton.
+  void compile();
+  bool isCompiled() const { return Compiled; }
+  bool empty() const { return States.size() == 1; }
+
+  /// match - Set the bit of every ID whose pattern occurs in \p Name.  \p IDs
+  /// is grown if needed; bits already set are left alone.
+  void match(llvm::StringRef Name, llvm::BitVector &IDs) const;
+};
+
+#endif  /* _PERFEVO_CALLEEMATCHER_H */
@@ -0,0 +1,71 @@
+//===- CheckerSet.h - Checker instances and dispatch tables -----*- C++ -*-===//
+//
+// A CheckerSet owns one instance of each selected function checker together
+// with the tables that decide which checkers see which instruction.  Checkers
+// keep per-function state, so every thread that walks functions needs a set
+// of its own.  Each checker prints to a stream of its own, so the output of
+// every checker can be cached separately.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_CHECKERSET_H
+#define _PERFEVO_CHECKERSET_H
+
+#include "CalleeMatcher.h"
+#include "PerfEvoChecker.h"
+#include "PerfStats.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+
+#include <vector>
+
+class CheckerSet {
+  // Indices into Checkers.
+  typedef llvm::SmallVector<unsigned, 2> CheckerList;
+
+  std::vector<PerfEvoChecker*> Checkers;
+  std::vector<const CheckerInfo*> Infos;
+  std::vector<CheckerInterest> Interests;
+  std::vector<CheckerList> OpcodeCheckers;
+  CheckerList AllInstCheckers;
+  // The triggers of the checkers that do not see every call anyway, with
+  // the checker index as ID, and what they matched, by callee.
+  CalleeMatcher Triggers;
+  llvm::DenseMap<const llvm::Function*, CheckerList> CalleeCheckers;
+  // CheckerAnalysis mask of what the checkers need.
+  unsigned Analyses;
+  // What each checker did in the current function, if statistics are on.
+  std::vector<CheckerCounters> Counters;
+  PerfStats *Stats;
+
+  const CheckerList &getCalleeCheckers(const llvm::Function *Callee);
+  void visit(unsigned Idx, llvm::Instruction *I, PerfEvo &Pass,
+             llvm::Function &F, BasicLoopInfo *LI, llvm::ScalarEvolution *SE,
+             const std::vector<llvm::raw_ostream*> &Outs);
+  void beginFunction(unsigned Idx, CheckerContext &C);
+  void endFunction(unsigned Idx, CheckerContext &C);
+
+  CheckerSet(const CheckerSet &);              // DO NOT IMPLEMENT
+  void operator=(const CheckerSet &);          // DO NOT IMPLEMENT
+public:
+  CheckerSet();
+  ~CheckerSet();
+
+  /// add - Create an instance of the checker described by \p Info.
+  void add(const CheckerInfo *Info);
+  void clear();
+
+  bool empty() const { return Checkers.empty(); }
+  unsigned size() const { return Checkers.size(); }
+  const CheckerInfo *getInfo(unsigned i) const { return Infos[i]; }
+  unsigned getAnalyses() const { return Analyses; }
+
+  /// run - Walk F once, handing every instruction to the checkers that asked
+  /// for it.  Checker i prints to Outs[i]; checkers whose stream is null are
+  /// not run.  SE may be null.
+  void run(PerfEvo &Pass, llvm::Function &F, BasicLoopInfo *LI,
+           llvm::ScalarEvolution *SE,
+           const std::vector<llvm::raw_ostream*> &Outs);
+};
+
+#endif  /* _PERFEVO_CHECKERSET_H */
@@ -0,0 +1,101 @@
+//===- Dataflow.h - Bit-vector dataflow over one function -------*- C++ -*-===//
+//
+// Checkers that reason about the order of events ("X reaches Y without an
+// intervening Z") describe the problem as a DataflowProblem: a direction, a
+// meet operator and a transfer function over bit vectors, with one bit per
+// fact the checker tracks.  DataflowSolver computes the fixed point with a
+// worklist in reverse post-order (post-order for backward problems), so
+// problems of this kind settle after a few passes over the blocks.  A problem
+// that has not settled after -perfDataflowLimit visits per block is given up.
+//
+// For example, to find the Y reached by an X with no Z in between, track one
+// bit per X; transfer sets the bit of an X and clears every bit at a Z; at a Y
+// the bits set in getInput(Y) name the X that reach it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_DATAFLOW_H
+#define _PERFEVO_DATAFLOW_H
+
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Instruction;
+}
+
+class DataflowProblem {
+public:
+  enum Direction { Forward, Backward };
+  /// MeetOp - How values from several predecessors (successors for backward
+  /// problems) are combined: Union for "on some path" facts, Intersection for
+  /// "on every path" facts.
+  enum MeetOp { Union, Intersection };
+
+private:
+  Direction Dir;
+  MeetOp Meet;
+  unsigned NumBits;
+
+public:
+  DataflowProblem(Direction D, MeetOp M, unsigned N = 0)
+    : Dir(D), Meet(M), NumBits(N) {}
+  virtual ~DataflowProblem() {}
+
+  Direction getDirection() const { return Dir; }
+  MeetOp getMeet() const { return Meet; }
+  unsigned getNumBits() const { return NumBits; }
+  void setNumBits(unsigned N) { NumBits = N; }
+
+  /// getBoundary - Set V, which has getNumBits() clear bits, to the value at
+  /// the function entry, or at every exit for backward problems.  Nothing
+  /// holds there by default.
+  virtual void getBoundary(llvm::BitVector &V) {}
+
+  /// transfer - Apply the effect of I to V, the value flowing into I.
+  virtual void transfer(llvm::Instruction *I, llvm::BitVector &V) = 0;
+};
+
+class DataflowSolver {
+  DataflowProblem &P;
+  // Blocks reachable from the entry, in the order they are visited.
+  std::vector<llvm::BasicBlock*> Order;
+  llvm::DenseMap<const llvm::BasicBlock*, unsigned> Numbers;
+  // The value at the start and at the end of every block in Order.
+  std::vector<llvm::BitVector> Begin, End;
+  llvm::BitVector Empty;
+  unsigned Visits;
+  bool Converged;
+
+  void meet(llvm::BitVector &V, const llvm::BitVector &In, bool First) const;
+public:
+  explicit DataflowSolver(DataflowProblem &Problem)
+    : P(Problem), Visits(0), Converged(false) {}
+
+  /// solve - Compute the fixed point of the problem over F.  Return false if
+  /// the iteration limit was reached first, in which case the values are
+  /// not to be relied on.
+  bool solve(llvm::Function &F);
+  bool hasConverged() const { return Converged; }
+  /// getNumVisits - How many times a block was run through transfer.
+  unsigned getNumVisits() const { return Visits; }
+  /// getVisitLimit - The visits per block after which solve gives up, as
+  /// set with -perfDataflowLimit.
+  static unsigned getVisitLimit();
+
+  /// getBlockBegin - The value at the start of BB in program order, empty if
+  /// BB is not reachable from the entry.
+  const llvm::BitVector &getBlockBegin(const llvm::BasicBlock *BB) const;
+  /// getBlockEnd - The value at the end of BB in program order.
+  const llvm::BitVector &getBlockEnd(const llvm::BasicBlock *BB) const;
+
+  /// getInput - Set V to the value flowing into I: the value before I for
+  /// forward problems, after I for backward ones.
+  void getInput(llvm::Instruction *I, llvm::BitVector &V) const;
+};
+
+#endif  /* _PERFEVO_DATAFLOW_H */
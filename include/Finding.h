@@ -0,0 +1,103 @@
+//===- Finding.h - Structured checker findings ------------------*- C++ -*-===//
+//
+// Checkers describe what they found with a Finding rather than printing it
+// themselves, so that every checker reports in the same format.  A finding is
+// rendered as one record in the format selected with -perfFormat:
+//
+//   text   path:line: checker in function, followed by the source line
+//   jsonl  one JSON object per line
+//   sarif  one SARIF 2.1.0 result per line, wrapped into a log by
+//          FindingsWriter
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_FINDING_H
+#define _PERFEVO_FINDING_H
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/DataTypes.h"
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+/// FindingLoc - A source position mentioned by a finding.
+struct FindingLoc {
+  /// File - Canonical path, empty if the position is unknown.
+  std::string File;
+  unsigned Line;
+  /// Source - The text of the line.
+  std::string Source;
+  /// Note - What happens at this position, for related locations.
+  std::string Note;
+
+  FindingLoc() : Line(0) {}
+};
+
+/// Finding - One performance problem reported by a checker.
+struct Finding {
+  /// Checker - The ID the checker was registered under.
+  std::string Checker;
+  /// Function - The function the problem was found in, empty for module
+  /// scope checkers.
+  std::string Function;
+  FindingLoc Loc;
+  /// Related - Other positions involved, e.g. the second call of a pair.
+  std::vector<FindingLoc> Related;
+  /// LoopDepth - Loop nesting depth of Loc, zero if not in a loop or not
+  /// computed.
+  unsigned LoopDepth;
+  /// EstimatedCount - How often Loc runs per entry into its loop nest, zero
+  /// unless trip counts were estimated.
+  double EstimatedCount;
+  /// TripCount - The factors of EstimatedCount, one per loop.
+  std::string TripCount;
+  /// Samples - The profile samples of Loc's line, or of Function if the
+  /// profile has none for the line.  Only meaningful if Profiled.
+  uint64_t Samples;
+  bool Profiled;
+  std::string Message;
+  /// Order - Where the finding comes in a serial run, so that findings of
+  /// equal weight are ranked the same however threads were scheduled.
+  uint64_t Order;
+
+  Finding() : LoopDepth(0), EstimatedCount(0), Samples(0), Profiled(false),
+              Order(0) {}
+};
+
+enum FindingFormat {
+  TextFormat,
+  JSONLinesFormat,
+  SARIFFormat
+};
+
+/// writeFinding - Render R as one record in Format.  Records in the JSON
+/// based formats take exactly one line.
+void writeFinding(const Finding &R, FindingFormat Format,
+                  llvm::raw_ostream &OS);
+
+/// writeJSONString - Write S as a quoted JSON string.
+void writeJSONString(llvm::raw_ostream &OS, llvm::StringRef S);
+
+/// FindingsWriter - Write rendered records to a stream, adding what the
+/// format needs around them.
+class FindingsWriter {
+  llvm::raw_ostream &OS;
+  FindingFormat Format;
+  bool NeedComma;
+  bool Finished;
+public:
+  FindingsWriter(llvm::raw_ostream &OS, FindingFormat Format);
+  ~FindingsWriter() { finish(); }
+
+  /// write - Append a sequence of records produced by writeFinding.
+  void write(llvm::StringRef Records);
+
+  /// finish - Close the document.  Called by the destructor if needed.
+  void finish();
+};
+
+#endif  /* _PERFEVO_FINDING_H */
@@ -0,0 +1,79 @@
+//===- FunctionHash.h - Structural fingerprints of functions ----*- C++ -*-===//
+//
+// A function's fingerprint changes whenever anything a checker could look at
+// changes: its instructions, their operands and types, the names of the
+// globals and functions it refers to, the initializers of the constants
+// among them, and the source locations of its instructions.  Checkers also
+// look up functions and named types by name, so the module's function
+// prototypes and named types get a fingerprint of their own.  Value and type
+// pointers are never hashed, so the same IR gets the same fingerprint in
+// every run.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_FUNCTIONHASH_H
+#define _PERFEVO_FUNCTIONHASH_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/DataTypes.h"
+
+namespace llvm {
+class Function;
+class GlobalVariable;
+class Module;
+class Type;
+class Value;
+}
+
+class LocationCache;
+class TypeNameTable;
+
+/// FNVHash - 64-bit FNV-1a.
+class FNVHash {
+  uint64_t H;
+public:
+  FNVHash() : H(14695981039346656037ULL) {}
+
+  void add(const void *Data, size_t Size) {
+    const unsigned char *P = static_cast<const unsigned char *>(Data);
+    for (size_t i = 0; i != Size; ++i) {
+      H ^= P[i];
+      H *= 1099511628211ULL;
+    }
+  }
+  void add(uint64_t V) { add(&V, sizeof(V)); }
+  void add(llvm::StringRef S) {
+    add(S.size());
+    add(S.data(), S.size());
+  }
+
+  uint64_t get() const { return H; }
+};
+
+class FunctionHasher {
+  TypeNameTable &Types;
+  LocationCache &Locations;
+
+  // Function-local values -> their position in the function.
+  llvm::DenseMap<const llvm::Value*, unsigned> Numbers;
+  // Constant globals whose initializer is already in the hash.
+  llvm::DenseSet<const llvm::GlobalVariable*> HashedGlobals;
+
+  void addType(FNVHash &H, const llvm::Type *T);
+  void addValue(FNVHash &H, const llvm::Value *V);
+public:
+  FunctionHasher(TypeNameTable &T, LocationCache &L)
+    : Types(T), Locations(L) {}
+
+  /// hash - Return the fingerprint of \p F.
+  uint64_t hash(const llvm::Function &F);
+
+  /// hashDeclarations - Return the fingerprint of the names and types of the
+  /// functions in \p M and of its named types.  Function bodies are left to
+  /// hash.
+  uint64_t hashDeclarations(const llvm::Module &M);
+};
+
+#endif  /* _PERFEVO_FUNCTIONHASH_H */
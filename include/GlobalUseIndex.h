@@ -0,0 +1,51 @@
+//===- GlobalUseIndex.h - Module-wide global variable uses ------*- C++ -*-===//
+//
+// Module scope checkers ask questions about every global variable, such as
+// which mutexes are only ever initialized and destroyed.  Walking the uses of
+// each global, and the uses of those uses, for every question is quadratic in
+// the worst case.  GlobalUseIndex walks the use lists of all globals once and
+// records, for each global, the instructions that use it, looking through one
+// constant expression, GEP or cast on the way, so a question about all globals
+// costs one lookup per global.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_GLOBALUSEINDEX_H
+#define _PERFEVO_GLOBALUSEINDEX_H
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <vector>
+
+namespace llvm {
+class GlobalVariable;
+class Instruction;
+class Module;
+}
+
+class GlobalUseIndex {
+public:
+  /// UseList - The instructions using one global, in use list order.
+  typedef std::vector<llvm::Instruction*> UseList;
+
+private:
+  llvm::DenseMap<const llvm::GlobalVariable*, UseList> Uses;
+  UseList NoUses;
+  bool Built;
+
+public:
+  GlobalUseIndex() : Built(false) {}
+
+  /// build - Index the uses of every global variable of \p M, replacing what
+  /// was indexed before.
+  void build(llvm::Module &M);
+  void clear();
+  bool isBuilt() const { return Built; }
+
+  /// getUses - The instructions using \p G directly, or using a constant
+  /// expression, GEP or cast of \p G.  The GEPs and casts themselves are
+  /// not listed.
+  const UseList &getUses(const llvm::GlobalVariable *G) const;
+};
+
+#endif  /* _PERFEVO_GLOBALUSEINDEX_H */
@@ -0,0 +1,232 @@
+//===- IRMatch.h - Matchers for instruction shapes --------------*- C++ -*-===//
+//
+// Structural checkers look for instructions of a certain shape, e.g. a GEP
+// with the indices 0, 0, 3 and a computed integer, or an equality compare of
+// a byte loaded through a GEP against a byte constant.  Spelling such a shape
+// out with nested dyn_casts takes dozens of lines; with these matchers it is
+// one expression:
+//
+//   if (match(I, m_GEP(m_Zero(), m_Zero(), m_ConstInt(3), m_IntValue())))
+//   if (match(Cond, m_ICmpEquality(m_Load(m_GEP(m_Value())), m_ConstI8())))
+//
+// Matchers are small objects composed at compile time, in the manner of
+// llvm/Support/PatternMatch.h, so a match inlines into the same tests the
+// hand-written code would make.  m_Bind and m_Value(V) remember what matched.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_IRMATCH_H
+#define _PERFEVO_IRMATCH_H
+
+#include "llvm/Constants.h"
+#include "llvm/Instructions.h"
+#include "llvm/System/DataTypes.h"
+
+namespace IRMatch {
+
+/// match - Whether V has the shape P describes.
+template<typename Pattern>
+inline bool match(llvm::Value *V, const Pattern &P) {
+  return P.match(V);
+}
+
+struct AnyValue_match {
+  bool match(llvm::Value *V) const { return true; }
+};
+
+struct BindValue_match {
+  llvm::Value *&Bound;
+  explicit BindValue_match(llvm::Value *&V) : Bound(V) {}
+  bool match(llvm::Value *V) const {
+    Bound = V;
+    return true;
+  }
+};
+
+/// m_Value - Any value, remembered in V if given.
+inline AnyValue_match m_Value() { return AnyValue_match(); }
+inline BindValue_match m_Value(llvm::Value *&V) { return BindValue_match(V); }
+
+struct AnyInst_match {
+  bool match(llvm::Value *V) const { return llvm::isa<llvm::Instruction>(V); }
+};
+
+/// m_Inst - Any instruction.
+inline AnyInst_match m_Inst() { return AnyInst_match(); }
+
+struct IntValue_match {
+  bool match(llvm::Value *V) const {
+    return llvm::isa<llvm::Instruction>(V) && V->getType()->isIntegerTy();
+  }
+};
+
+/// m_IntValue - An integer computed by an instruction.
+inline IntValue_match m_IntValue() { return IntValue_match(); }
+
+struct ConstInt_match {
+  uint64_t Value;
+  bool Any;
+  ConstInt_match(uint64_t V, bool A) : Value(V), Any(A) {}
+  bool match(llvm::Value *V) const {
+    if (llvm::ConstantInt *CI = llvm::dyn_cast<llvm::ConstantInt>(V))
+      return Any || CI->equalsInt(Value);
+    return false;
+  }
+};
+
+/// m_ConstInt - An integer constant, equal to N if given.
+inline ConstInt_match m_ConstInt() { return ConstInt_match(0, true); }
+inline ConstInt_match m_ConstInt(uint64_t N) { return ConstInt_match(N, false); }
+
+/// m_Zero - An integer constant zero.
+inline ConstInt_match m_Zero() { return ConstInt_match(0, false); }
+
+struct ConstI8_match {
+  bool match(llvm::Value *V) const {
+    return llvm::isa<llvm::ConstantInt>(V) && V->getType()->isIntegerTy(8);
+  }
+};
+
+/// m_ConstI8 - A constant of type i8, i.e. a char.
+inline ConstI8_match m_ConstI8() { return ConstI8_match(); }
+
+template<typename Class, typename SubPattern>
+struct Bind_match {
+  Class *&Bound;
+  SubPattern P;
+  Bind_match(Class *&B, const SubPattern &S) : Bound(B), P(S) {}
+  bool match(llvm::Value *V) const {
+    Class *C = llvm::dyn_cast<Class>(V);
+    if (!C || !P.match(V))
+      return false;
+    Bound = C;
+    return true;
+  }
+};
+
+/// m_Bind - What P matches, remembered in B.  The value also has to be a
+/// Class.
+template<typename Class, typename SubPattern>
+inline Bind_match<Class, SubPattern> m_Bind(Class *&B, const SubPattern &P) {
+  return Bind_match<Class, SubPattern>(B, P);
+}
+
+template<typename PtrPattern>
+struct Load_match {
+  PtrPattern Ptr;
+  explicit Load_match(const PtrPattern &P) : Ptr(P) {}
+  bool match(llvm::Value *V) const {
+    llvm::LoadInst *L = llvm::dyn_cast<llvm::LoadInst>(V);
+    return L && Ptr.match(L->getPointerOperand());
+  }
+};
+
+/// m_Load - A load from a pointer Ptr matches.
+template<typename PtrPattern>
+inline Load_match<PtrPattern> m_Load(const PtrPattern &Ptr) {
+  return Load_match<PtrPattern>(Ptr);
+}
+
+/// GEP_match - A GEP instruction with NumIndices indices, matched by
+/// I0 ... I3 in order.  Matchers past NumIndices are not used.
+template<typename I0, typename I1 = AnyValue_match,
+         typename I2 = AnyValue_match, typename I3 = AnyValue_match>
+struct GEP_match {
+  unsigned NumIndices;
+  I0 Idx0;
+  I1 Idx1;
+  I2 Idx2;
+  I3 Idx3;
+  GEP_match(unsigned N, const I0 &P0, const I1 &P1 = I1(),
+            const I2 &P2 = I2(), const I3 &P3 = I3())
+    : NumIndices(N), Idx0(P0), Idx1(P1), Idx2(P2), Idx3(P3) {}
+  bool match(llvm::Value *V) const {
+    llvm::GetElementPtrInst *GEP = llvm::dyn_cast<llvm::GetElementPtrInst>(V);
+    if (!GEP || GEP->getNumIndices() != NumIndices)
+      return false;
+    return Idx0.match(GEP->getOperand(1)) &&
+           (NumIndices < 2 || Idx1.match(GEP->getOperand(2))) &&
+           (NumIndices < 3 || Idx2.match(GEP->getOperand(3))) &&
+           (NumIndices < 4 || Idx3.match(GEP->getOperand(4)));
+  }
+};
+
+/// m_GEP - A GEP instruction with exactly as many indices as matchers given,
+/// each index matching its matcher.  The pointer operand can be anything.
+template<typename I0>
+inline GEP_match<I0> m_GEP(const I0 &P0) {
+  return GEP_match<I0>(1, P0);
+}
+
+template<typename I0, typename I1>
+inline GEP_match<I0, I1> m_GEP(const I0 &P0, const I1 &P1) {
+  return GEP_match<I0, I1>(2, P0, P1);
+}
+
+template<typename I0, typename I1, typename I2>
+inline GEP_match<I0, I1, I2> m_GEP(const I0 &P0, const I1 &P1,
+                                   const I2 &P2) {
+  return GEP_match<I0, I1, I2>(3, P0, P1, P2);
+}
+
+template<typename I0, typename I1, typename I2, typename I3>
+inline GEP_match<I0, I1, I2, I3> m_GEP(const I0 &P0, const I1 &P1,
+                                       const I2 &P2, const I3 &P3) {
+  return GEP_match<I0, I1, I2, I3>(4, P0, P1, P2, P3);
+}
+
+/// ICmp_match - An icmp whose predicate passes Kind, with operands matched
+/// by L and R, in either order if Commutable.
+template<typename LHSPattern, typename RHSPattern>
+struct ICmp_match {
+  enum PredicateKind { AnyPredicate, EqPredicate, EqualityPredicate };
+
+  PredicateKind Kind;
+  bool Commutable;
+  LHSPattern L;
+  RHSPattern R;
+  ICmp_match(PredicateKind K, bool C, const LHSPattern &LP,
+             const RHSPattern &RP) : Kind(K), Commutable(C), L(LP), R(RP) {}
+  bool match(llvm::Value *V) const {
+    llvm::ICmpInst *Cmp = llvm::dyn_cast<llvm::ICmpInst>(V);
+    if (!Cmp)
+      return false;
+    if (Kind == EqPredicate &&
+        Cmp->getPredicate() != llvm::ICmpInst::ICMP_EQ)
+      return false;
+    if (Kind == EqualityPredicate && !Cmp->isEquality())
+      return false;
+    if (L.match(Cmp->getOperand(0)) && R.match(Cmp->getOperand(1)))
+      return true;
+    return Commutable &&
+           L.match(Cmp->getOperand(1)) && R.match(Cmp->getOperand(0));
+  }
+};
+
+/// m_ICmp - An icmp of any predicate comparing L to R, in that order.
+template<typename LHSPattern, typename RHSPattern>
+inline ICmp_match<LHSPattern, RHSPattern>
+m_ICmp(const LHSPattern &L, const RHSPattern &R) {
+  typedef ICmp_match<LHSPattern, RHSPattern> MatchTy;
+  return MatchTy(MatchTy::AnyPredicate, false, L, R);
+}
+
+/// m_ICmpEq - An icmp eq of L and R, in either order.
+template<typename LHSPattern, typename RHSPattern>
+inline ICmp_match<LHSPattern, RHSPattern>
+m_ICmpEq(const LHSPattern &L, const RHSPattern &R) {
+  typedef ICmp_match<LHSPattern, RHSPattern> MatchTy;
+  return MatchTy(MatchTy::EqPredicate, true, L, R);
+}
+
+/// m_ICmpEquality - An icmp eq or ne of L and R, in either order.
+template<typename LHSPattern, typename RHSPattern>
+inline ICmp_match<LHSPattern, RHSPattern>
+m_ICmpEquality(const LHSPattern &L, const RHSPattern &R) {
+  typedef ICmp_match<LHSPattern, RHSPattern> MatchTy;
+  return MatchTy(MatchTy::EqualityPredicate, true, L, R);
+}
+
+} // end namespace IRMatch
+
+#endif  /* _PERFEVO_IRMATCH_H */
@@ -0,0 +1,77 @@
+//===- LocationCache.h - Interned debug locations ---------------*- C++ -*-===//
+//
+// Resolving an instruction's debug location to a canonical path costs a
+// string concatenation and a realpath() call.  LocationCache interns every
+// directory/filename pair once and remembers which file each debug scope
+// belongs to, so resolving an instruction is a couple of hash lookups and
+// never allocates.  Lookups may come from several threads at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_LOCATIONCACHE_H
+#define _PERFEVO_LOCATIONCACHE_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/System/RWMutex.h"
+
+#include <deque>
+#include <string>
+
+namespace llvm {
+class Instruction;
+class MDNode;
+}
+
+/// SourceLoc - A source position whose file is an index into the
+/// LocationCache file table.
+struct SourceLoc {
+  unsigned File;
+  unsigned Line;
+
+  SourceLoc() : File(~0U), Line(0) {}
+  SourceLoc(unsigned F, unsigned L) : File(F), Line(L) {}
+
+  bool operator==(const SourceLoc &RHS) const {
+    return File == RHS.File && Line == RHS.Line;
+  }
+};
+
+class LocationCache {
+  // Debug scope -> interned file.
+  llvm::DenseMap<const llvm::MDNode*, unsigned> ScopeFiles;
+  // Inlined-at DILocation -> outermost call site location.
+  llvm::DenseMap<const llvm::MDNode*, SourceLoc> InlinedLocs;
+  // "directory/filename" as written in the debug info -> interned file.
+  llvm::StringMap<unsigned> FileIDs;
+  // Interned file -> canonical path, empty if the file could not be found.
+  // A deque, so references handed out by getPath survive later insertions.
+  std::deque<std::string> Paths;
+  // Guards all of the above.
+  mutable llvm::sys::RWMutex Lock;
+
+  // These fill the tables and must be called with Lock held for writing.
+  unsigned getFileForScope(const llvm::MDNode *Scope);
+  SourceLoc resolveInlinedAt(const llvm::MDNode *IA);
+
+  bool isFound(const SourceLoc &Loc) const {
+    return Loc.File < Paths.size() && !Paths[Loc.File].empty();
+  }
+public:
+  /// lookup - Find the source position of \p I, looking through inlined
+  /// frames to the outermost call site.  Returns false if \p I has no debug
+  /// location or its file cannot be found on disk.
+  bool lookup(const llvm::Instruction *I, SourceLoc &Loc);
+
+  /// getPath - Return the canonical path of an interned file.
+  const std::string &getPath(unsigned File) const {
+    llvm::sys::ScopedReader Guard(Lock);
+    return Paths[File];
+  }
+  unsigned getNumFiles() const {
+    llvm::sys::ScopedReader Guard(Lock);
+    return Paths.size();
+  }
+};
+
+#endif  /* _PERFEVO_LOCATIONCACHE_H */
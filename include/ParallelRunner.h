@@ -0,0 +1,34 @@
+//===- ParallelRunner.h - Run function checkers on many threads -*- C++ -*-===//
+//
+// Checkers only read the IR, so functions can be checked independently.  The
+// parallel runner spreads a module's functions over a pool of threads that
+// steal work from each other and buffers each function's output, so the
+// caller can print it in module order and get the same result as a serial
+// run.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_PARALLELRUNNER_H
+#define _PERFEVO_PARALLELRUNNER_H
+
+#include <vector>
+
+#include <string>
+
+namespace llvm {
+class Function;
+}
+
+class PerfEvo;
+struct CheckerInfo;
+
+/// runCheckersInParallel - Run the function checkers in \p Selected over
+/// \p Functions on \p NumThreads threads.  Outputs[i] receives what the
+/// checkers printed for Functions[i].
+void runCheckersInParallel(PerfEvo &Pass,
+                           const std::vector<llvm::Function*> &Functions,
+                           const std::vector<const CheckerInfo*> &Selected,
+                           unsigned NumThreads,
+                           std::vector<std::string> &Outputs);
+
+#endif  /* _PERFEVO_PARALLELRUNNER_H */
@@ -0,0 +1,180 @@
+//===- PerfEvoChecker.h - Interface implemented by checkers -----*- C++ -*-===//
+//
+// A checker looks for one known performance bug pattern.  Rather than walking
+// every function itself, a checker tells PerfEvo which instructions it is
+// interested in; PerfEvo walks each function once and hands every
+// instruction to all checkers that asked for it.
+//
+// Checkers hand what they find to CheckerContext::report as a Finding, which
+// renders it in the output format the user selected.
+//
+// Checkers add themselves to the CheckerRegistry at static initialization
+// time with a RegisterChecker object, so PerfEvo needs no list of them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_CHECKER_H
+#define _PERFEVO_CHECKER_H
+
+#include "Finding.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Instruction;
+class Loop;
+template<class BlockT, class LoopT> class LoopInfoBase;
+class raw_ostream;
+class ScalarEvolution;
+}
+
+class PerfEvo;
+
+typedef llvm::LoopInfoBase<llvm::BasicBlock, llvm::Loop> BasicLoopInfo;
+
+/// CheckerContext - Everything a checker may use while a function is walked.
+struct CheckerContext {
+  PerfEvo &Pass;
+  /// CheckerID - The ID the running checker was registered under.
+  const char *CheckerID;
+  llvm::Function &F;
+  /// LI - Loop information for F.  Only computed if the checker was
+  /// registered with NeedsLoopInfo; null otherwise.
+  BasicLoopInfo *LI;
+  /// SE - Scalar evolution for F.  Only computed with -perfTripCounts when
+  /// functions are checked by the pass manager; null otherwise.
+  llvm::ScalarEvolution *SE;
+  llvm::raw_ostream &Out;
+  /// NumFindings - Findings reported through this context.
+  unsigned NumFindings;
+
+  CheckerContext(PerfEvo &P, const char *ID, llvm::Function &Fn,
+                 BasicLoopInfo *L, llvm::ScalarEvolution *S,
+                 llvm::raw_ostream &O)
+    : Pass(P), CheckerID(ID), F(Fn), LI(L), SE(S), Out(O), NumFindings(0) {}
+
+  /// getLoc - Return the source position of I and the text of its line,
+  /// with Note attached.
+  FindingLoc getLoc(llvm::Instruction *I, llvm::StringRef Note = "");
+
+  /// report - Report a finding at I.  With -perfTripCounts, findings in
+  /// loops get an estimate of how often I runs.
+  void report(llvm::Instruction *I, unsigned LoopDepth = 0,
+              llvm::StringRef Message = "");
+
+  /// report - Report R at I, filling in its location and, with
+  /// -perfTripCounts, the estimate for its loop depth.
+  void report(llvm::Instruction *I, Finding &R);
+
+  /// report - Report R, filling in the checker and function.
+  void report(Finding &R);
+};
+
+/// CheckerInterest - The instructions a checker wants to be shown.
+struct CheckerInterest {
+  /// Opcodes - Every instruction with one of these opcodes is dispatched.
+  std::vector<unsigned> Opcodes;
+  /// AllInstructions - Dispatch every instruction in the function.
+  bool AllInstructions;
+
+  CheckerInterest() : AllInstructions(false) {}
+};
+
+class PerfEvoChecker {
+public:
+  virtual ~PerfEvoChecker() {}
+
+  /// getInterest - Describe which instructions visit should be called on,
+  /// besides the calls to the checker's registered triggers.
+  virtual void getInterest(CheckerInterest &I) const {}
+
+  /// beginFunction - Called before the first instruction of a function is
+  /// dispatched.
+  virtual void beginFunction(CheckerContext &C) {}
+
+  /// visit - Called, in program order, for each instruction of interest.
+  virtual void visit(llvm::Instruction *I, CheckerContext &C) {}
+
+  /// endFunction - Called after the last instruction has been dispatched.
+  virtual void endFunction(CheckerContext &C) {}
+
+  /// runOnModule - Called once per module for checkers registered with
+  /// ModuleScope, which never see individual instructions.  Findings are
+  /// written to Out with PerfEvo::writeFinding.
+  virtual void runOnModule(PerfEvo &Pass, llvm::raw_ostream &Out) {}
+};
+
+/// CheckerScope - Whether a checker looks at one function at a time or at
+/// the module as a whole.
+enum CheckerScope {
+  FunctionScope,
+  ModuleScope
+};
+
+/// CheckerAnalysis - Analyses a checker needs PerfEvo to compute for it.
+enum CheckerAnalysis {
+  NoAnalyses    = 0,
+  NeedsLoopInfo = 1 << 0
+};
+
+/// CheckerInfo - A registry entry describing one checker.
+struct CheckerInfo {
+  /// ID - The name accepted by -perfBugID.
+  const char *ID;
+  CheckerScope Scope;
+  /// Analyses - A mask of CheckerAnalysis values.
+  unsigned Analyses;
+  /// Triggers - Null terminated list of callee name substrings, or null.
+  /// Calls and invokes whose direct callee's name contains a trigger are
+  /// dispatched to the checker, and a module defining or declaring no
+  /// function whose name contains a trigger is skipped.  A checker without
+  /// triggers always runs.
+  const char *const *Triggers;
+  /// Source - The text of the rule for checkers defined in a rule file, so
+  /// cached output is dropped when the rule changes; null otherwise.
+  const char *Source;
+  /// Create - Return a new instance of the checker \p Info describes.
+  PerfEvoChecker *(*Create)(const CheckerInfo &Info);
+};
+
+/// CheckerRegistry - All checkers linked into PerfEvo, in registration order.
+class CheckerRegistry {
+public:
+  typedef std::vector<const CheckerInfo*>::const_iterator iterator;
+
+  static void add(const CheckerInfo *Info);
+  /// lookup - Return the checker registered under ID, or null.
+  static const CheckerInfo *lookup(llvm::StringRef ID);
+  static iterator begin();
+  static iterator end();
+};
+
+/// RegisterChecker - Declare a static RegisterChecker to make a checker
+/// selectable with -perfBugID:
+///
+///   static const char *const Triggers[] = { "apr_stat", 0 };
+///   static RegisterChecker<ApacheBug45464>
+///   RegApacheBug45464("ApacheBug45464", FunctionScope, NoAnalyses, Triggers);
+///
+template<class CheckerT>
+class RegisterChecker {
+  CheckerInfo Info;
+
+  static PerfEvoChecker *create(const CheckerInfo &) { return new CheckerT(); }
+public:
+  RegisterChecker(const char *ID, CheckerScope Scope, unsigned Analyses,
+                  const char *const *Triggers = 0) {
+    Info.ID = ID;
+    Info.Scope = Scope;
+    Info.Analyses = Analyses;
+    Info.Triggers = Triggers;
+    Info.Source = 0;
+    Info.Create = &create;
+    CheckerRegistry::add(&Info);
+  }
+};
+
+#endif  /* _PERFEVO_CHECKER_H */
@@ -0,0 +1,122 @@
+//===- PerfStats.h - Timers and counters for PerfEvo runs -------*- C++ -*-===//
+//
+// With -perfStats, PerfEvo measures where a run spends its time: the wall
+// and CPU time of each phase and of each checker, how many instructions and
+// trigger calls every checker was shown, how many findings it reported, how
+// much source text was loaded, and which functions each checker took longest
+// on.  The numbers are printed when LLVM shuts down, like -stats, or written
+// as JSON to the file given with -perfStatsFile.
+//
+// Without either option PerfStats::get returns null and nothing is measured.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_PERFSTATS_H
+#define _PERFEVO_PERFSTATS_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/Atomic.h"
+#include "llvm/System/DataTypes.h"
+#include "llvm/System/Mutex.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+/// StatsTimer - Wall time and CPU time of the calling thread since the timer
+/// was created or last reset.
+class StatsTimer {
+  double Wall;
+  double CPU;
+public:
+  StatsTimer() { reset(); }
+  void reset();
+  void getElapsed(double &W, double &C) const;
+};
+
+/// CheckerCounters - What one checker did in one function.
+struct CheckerCounters {
+  double Wall;
+  double CPU;
+  /// Visited - Instructions handed to the checker.
+  uint64_t Visited;
+  /// CallsMatched - Calls handed to the checker because the callee matched
+  /// one of its triggers.
+  uint64_t CallsMatched;
+  uint64_t Findings;
+
+  CheckerCounters() : Wall(0), CPU(0), Visited(0), CallsMatched(0),
+                      Findings(0) {}
+};
+
+class PerfStats {
+  struct PhaseStats {
+    double Wall;
+    double CPU;
+    uint64_t Runs;
+    PhaseStats() : Wall(0), CPU(0), Runs(0) {}
+  };
+
+  struct CheckerStats {
+    CheckerCounters Total;
+    uint64_t Functions;
+    // The slowest functions, slowest first.
+    std::vector<std::pair<double, std::string> > Slowest;
+    CheckerStats() : Functions(0) {}
+  };
+
+  // Phases and checkers are listed in the order they were first seen.
+  std::vector<std::string> PhaseOrder;
+  llvm::StringMap<PhaseStats> Phases;
+  std::vector<std::string> CheckerOrder;
+  llvm::StringMap<CheckerStats> Checkers;
+  uint64_t InstsWalked;
+  uint64_t SourceFiles;
+  uint64_t SourceLinesLoaded;
+  volatile llvm::sys::cas_flag SourceLinesRead;
+  // Guards everything but SourceLinesRead.
+  llvm::sys::Mutex Lock;
+
+  void print(llvm::raw_ostream &OS);
+  void printJSON(llvm::raw_ostream &OS);
+public:
+  PerfStats();
+  /// ~PerfStats - Print or write out the statistics.
+  ~PerfStats();
+
+  /// get - The statistics of this process, or null if they were not asked
+  /// for.
+  static PerfStats *get();
+
+  // All of the following may be called from several threads at once.
+  void addPhase(llvm::StringRef Name, double Wall, double CPU);
+  void addFunction(llvm::StringRef Checker, llvm::StringRef Function,
+                   const CheckerCounters &C);
+  void addInstructionsWalked(uint64_t N);
+  void addSourceFile(unsigned Lines);
+  void addSourceLineRead() { llvm::sys::AtomicIncrement(&SourceLinesRead); }
+};
+
+/// PhaseTimer - Add the time until the end of the enclosing scope to a
+/// phase, if statistics are enabled.
+class PhaseTimer {
+  PerfStats *Stats;
+  const char *Name;
+  StatsTimer T;
+public:
+  explicit PhaseTimer(const char *N) : Stats(PerfStats::get()), Name(N) {}
+  ~PhaseTimer() {
+    if (!Stats)
+      return;
+    double Wall, CPU;
+    T.getElapsed(Wall, CPU);
+    Stats->addPhase(Name, Wall, CPU);
+  }
+};
+
+#endif  /* _PERFEVO_PERFSTATS_H */
@@ -0,0 +1,57 @@
+//===- Profile.h - Sample counts of the checked program ---------*- C++ -*-===//
+//
+// A finding in code that never runs is not worth a reviewer's time.  With
+// -perfProfile, PerfEvo reads how often the checked program was seen in each
+// function or on each source line and attaches the count to every finding.
+// Two text formats are understood:
+//
+//   <count> <function>         one entry per line, as printed by
+//   <count> <file>:<line>      "perf script -F sym --no-demangle |
+//                              sort | uniq -c"
+//
+//   a gprof flat profile       the "self seconds" column, in samples of
+//                              10ms, counts for the function; run gprof
+//                              with --no-demangle
+//
+// Functions are looked up by their mangled names, as in the IR, so C++
+// functions only match profiles that were not demangled.
+// Counts for the same function or line add up.  Lines are looked up by the
+// full path first and by the file name alone if the profile has no entry for
+// the path, since profiles are often taken on another machine.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_PROFILE_H
+#define _PERFEVO_PROFILE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/DataTypes.h"
+
+#include <string>
+
+class Profile {
+  llvm::StringMap<uint64_t> Functions;
+  // "path:line" and "name:line" -> samples.
+  llvm::StringMap<uint64_t> Lines;
+  llvm::StringMap<uint64_t> FileNameLines;
+  bool Loaded;
+
+  void addLine(llvm::StringRef File, unsigned Line, uint64_t Count);
+  bool parseGprof(llvm::StringRef Text);
+public:
+  Profile() : Loaded(false) {}
+
+  /// load - Read the profile in Filename.  Return false and set ErrMsg,
+  /// starting with Filename, if it cannot be read or is in neither format.
+  bool load(llvm::StringRef Filename, std::string &ErrMsg);
+  bool isLoaded() const { return Loaded; }
+
+  /// getFunctionSamples - The samples counted for the function Name.
+  uint64_t getFunctionSamples(llvm::StringRef Name) const;
+
+  /// getLineSamples - The samples counted for line Line of File.
+  uint64_t getLineSamples(llvm::StringRef File, unsigned Line) const;
+};
+
+#endif  /* _PERFEVO_PROFILE_H */
@@ -0,0 +1,55 @@
+//===- RuleFile.h - Call pattern checkers defined in text files -*- C++ -*-===//
+//
+// Many checkers have the same shape: a call whose callee has a certain name,
+// whose arguments are certain constants or of a certain type, possibly inside
+// a loop.  Such checkers can be written as rules in a file given with
+// -perfRules instead of being compiled into PerfEvo:
+//
+//   # apr_stat asking for every field of apr_finfo_t
+//   rule ApacheStatAll
+//     callee apr_*stat
+//     arg 2 == 0x0073b170
+//     arg 0 type %struct.apr_finfo_t*
+//     message apr_stat fills in every field
+//
+// A rule starts with "rule <ID>"; the ID selects it with -perfBugID like any
+// other checker.  Each further line adds a condition, all of which must hold:
+//
+//   callee <glob>           the callee's name, '*' and '?' as in the shell;
+//                           required, with at least one other character
+//   args <n>                the call has n arguments
+//   arg <i> == <int>        argument i (from 0) is this integer constant,
+//   arg <i> != <int>        or is something else
+//   arg <i> const           argument i is a constant
+//   arg <i> string <glob>   argument i points to a constant C string that
+//                           matches the glob
+//   arg <i> type <type>     argument i has the type printed as <type>
+//   arg <i> from <glob>     argument i is the result of a call of a function
+//                           whose name matches the glob
+//   result used|unused      whether the call's result is used
+//   loop >=|==|<= <n>       the loop depth of the call
+//   message <text>          what the finding says
+//
+// The literal part of the callee glob becomes a trigger of the rule, so rules
+// are dispatched through the same callee matcher as compiled checkers and
+// cost nothing at calls of other functions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_RULEFILE_H
+#define _PERFEVO_RULEFILE_H
+
+#include "llvm/ADT/StringRef.h"
+
+#include <string>
+
+/// loadRuleFile - Parse the rules in Filename and add a checker for each to
+/// the CheckerRegistry.  Return false and set ErrMsg if the file cannot be
+/// read or has an error, in which case no rule of it is added.
+bool loadRuleFile(llvm::StringRef Filename, std::string &ErrMsg);
+
+/// matchGlob - Whether all of Name matches Pattern, in which '*' stands for
+/// any run of characters and '?' for any one character.
+bool matchGlob(llvm::StringRef Pattern, llvm::StringRef Name);
+
+#endif  /* _PERFEVO_RULEFILE_H */
@@ -0,0 +1,77 @@
+//===- SourceCache.h - Lazily mapped source text ----------------*- C++ -*-===//
+//
+// Checkers print (and sometimes grep) the source line behind an instruction.
+// SourceCache maps a source file into memory the first time one of its lines
+// is requested and indexes the line starts, so only files that are actually
+// looked at are ever touched.  The first text search in a file also indexes
+// the lines every identifier occurs on, so searches look at the few lines
+// that can match rather than at every line asked about.  Lines may be
+// requested from several threads at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_SOURCECACHE_H
+#define _PERFEVO_SOURCECACHE_H
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/DataTypes.h"
+#include "llvm/System/RWMutex.h"
+
+#include <vector>
+
+class SourceCache {
+  typedef llvm::StringMap<std::vector<unsigned> > LineIndex;
+
+  struct SourceFile {
+    const char *Data;
+    size_t Size;
+    // Offset of the first character of every line; line N starts at
+    // LineStarts[N - 1].
+    std::vector<uint32_t> LineStarts;
+    // Identifier -> the lines it occurs on, built by the first search.
+    LineIndex *Tokens;
+    // Pattern -> the lines containing it, for every pattern searched for.
+    LineIndex Searches;
+
+    SourceFile() : Data(0), Size(0), Tokens(0) {}
+  };
+
+  llvm::StringMap<SourceFile*> Files;
+  // Guards Files, and Tokens and Searches of every file.  Mapped text and
+  // line starts are never changed once published.
+  llvm::sys::RWMutex Lock;
+
+  SourceFile *getFile(llvm::StringRef Path);
+  static void loadFile(llvm::StringRef Path, SourceFile *SF);
+  static llvm::StringRef getLine(const SourceFile *SF, unsigned Line);
+  static void indexTokens(SourceFile *SF);
+  static void search(SourceFile *SF, llvm::StringRef Pattern,
+                     std::vector<unsigned> &Lines);
+
+  SourceCache(const SourceCache &);            // DO NOT IMPLEMENT
+  void operator=(const SourceCache &);         // DO NOT IMPLEMENT
+public:
+  SourceCache() {}
+  ~SourceCache();
+
+  /// getLine - Return the text of line \p Line (1-based) of \p Path without
+  /// its trailing newline, or an empty string if the file cannot be read or
+  /// has no such line.  The returned text stays valid for the lifetime of the
+  /// cache.
+  llvm::StringRef getLine(llvm::StringRef Path, unsigned Line);
+
+  /// findLines - Return the numbers of the lines of \p Path that contain
+  /// \p Pattern, in increasing order.  The result is computed once per file
+  /// and pattern and stays valid for the lifetime of the cache.
+  const std::vector<unsigned> &findLines(llvm::StringRef Path,
+                                         llvm::StringRef Pattern);
+
+  /// lineContains - Return true if line \p Line of \p Path contains
+  /// \p Pattern.  Every line contains the empty pattern, even lines that
+  /// cannot be read.
+  bool lineContains(llvm::StringRef Path, unsigned Line,
+                    llvm::StringRef Pattern);
+};
+
+#endif  /* _PERFEVO_SOURCECACHE_H */
@@ -0,0 +1,37 @@
+//===- TripCount.h - Loop nest trip count estimates -------------*- C++ -*-===//
+//
+// A call in a loop that runs three times matters less than the same call in a
+// loop over every element of a table.  With -perfTripCounts, findings inside
+// loops carry an estimate of how often their block runs per call of the
+// function: the product of the trip counts of the loops around it.  Trip
+// counts come from ScalarEvolution when the pass manager computed it and from
+// the loop's canonical induction variable otherwise; loops whose trip count
+// is not a known constant are assumed to run a fixed number of times.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_TRIPCOUNT_H
+#define _PERFEVO_TRIPCOUNT_H
+
+#include "llvm/System/DataTypes.h"
+
+#include <string>
+
+namespace llvm {
+class Loop;
+class ScalarEvolution;
+}
+
+/// estimateTripCount - Return the estimated number of times the body of L
+/// runs per entry into its outermost loop, and describe the product in Text,
+/// e.g. "10 x (1 + %n)" with one factor per loop from the outermost in.  SE
+/// may be null.  Factors that are not known constants, printed symbolically
+/// or as "?", count as Unknown.
+double estimateTripCount(const llvm::Loop *L, llvm::ScalarEvolution *SE,
+                         unsigned Unknown, std::string &Text);
+
+/// getConstantTripCount - Return the number of iterations of L alone, or
+/// zero if it is not a known constant.  SE may be null.
+uint64_t getConstantTripCount(const llvm::Loop *L, llvm::ScalarEvolution *SE);
+
+#endif  /* _PERFEVO_TRIPCOUNT_H */
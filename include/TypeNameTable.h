@@ -0,0 +1,48 @@
+//===- TypeNameTable.h - Module-wide type names -----------------*- C++ -*-===//
+//
+// Several checkers recognize objects by the printed name of their type, e.g.
+// "%struct.apr_finfo_t*".  Naming types requires walking the whole module, so
+// TypeNameTable does that once per module, prints every type it finds and
+// answers later queries from the cache, which is safe to read from several
+// threads at once.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef _PERFEVO_TYPENAMETABLE_H
+#define _PERFEVO_TYPENAMETABLE_H
+
+#include "llvm/Assembly/Writer.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/System/RWMutex.h"
+
+#include <vector>
+
+namespace llvm {
+class Module;
+class Type;
+}
+
+class TypeNameTable {
+  typedef llvm::StringMapEntry<const llvm::Type*> NameEntry;
+
+  llvm::TypePrinting Printer;
+  std::vector<const llvm::Type*> NumberedTypes;
+  llvm::DenseMap<const llvm::Type*, const NameEntry*> Names;
+  llvm::StringMap<const llvm::Type*> ByName;
+  // Guards the tables above; only types reset did not see need the writer.
+  mutable llvm::sys::RWMutex Lock;
+public:
+  /// reset - Name and print every type used by \p M.
+  void reset(const llvm::Module *M);
+
+  /// getName - Return the name TypePrinting gives \p T.
+  llvm::StringRef getName(const llvm::Type *T);
+
+  /// lookup - Return the type printed as \p Name, or null if no type used by
+  /// the module prints that way.
+  const llvm::Type *lookup(llvm::StringRef Name) const;
+};
+
+#endif  /* _PERFEVO_TYPENAMETABLE_H */
@@ -28,9 +28,22 @@ class LoopInfo;
 class CallSite;
 }
 
+#include "AnalysisCache.h"
+#include "CallSiteIndex.h"
+#include "CheckerSet.h"
+#include "Finding.h"
+#include "GlobalUseIndex.h"
+#include "LocationCache.h"
+#include "PerfEvoChecker.h"
+#include "Profile.h"
+#include "SourceCache.h"
+#include "TypeNameTable.h"
 #include "llvm/Pass.h"
-#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringRef.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/System/Mutex.h"
 #include <set>
 #include <string>
 #include <vector>
@@ -38,59 +51,157 @@ class CallSite;
 #include <list>
 #include <utility>
 
+/// ReportCollector - Receives PerfEvo's output one function at a time
+/// instead of having it printed, so a driver checking many modules can merge
+/// and deduplicate it.
+class ReportCollector {
+public:
+  virtual ~ReportCollector() {}
+
+  /// addReport - Text is what the checkers printed for function Func, or
+  /// for the module as a whole if Func is empty.  Never called with empty
+  /// Text.
+  virtual void addReport(llvm::StringRef Func, llvm::StringRef Text) = 0;
+
+  /// ranksFindings - Whether the collector ranks the findings of
+  /// -perfTripCounts and -perfProfile across modules itself.  If so, each
+  /// module's findings are handed to addRankedFindings in the order a serial
+  /// run finds them instead of being listed per module.
+  virtual bool ranksFindings() const { return false; }
+  virtual void addRankedFindings(const std::vector<Finding> &Findings) {}
+};
+
 class PerfEvo : public llvm::FunctionPass {
   llvm::raw_ostream &Err;
   llvm::Module *_M;
-  std::map<std::string, std::vector<std::string> > source_files;
+  llvm::OwningPtr<SourceCache> OwnedSources;
+  SourceCache *Sources;
+  ReportCollector *Collector;
+  llvm::OwningPtr<AnalysisCache> OwnedCache;
+  AnalysisCache *Cache;
+  // With a cache, the fingerprint of the module's prototypes and named types.
+  uint64_t Declarations;
+  // Where findings go when there is no collector.
+  llvm::OwningPtr<llvm::raw_fd_ostream> OwnedOut;
+  llvm::OwningPtr<FindingsWriter> Writer;
+  LocationCache Locations;
+  TypeNameTable Types;
+  CallSiteIndex CallSites;
+  // Built on first use by a module scope checker.
+  GlobalUseIndex GlobalUses;
+  // The samples given with -perfProfile, shared by all instances; null
+  // without a profile.
+  const Profile *Samples;
+
+  // The function checkers selected with -perfBugID that apply to the
+  // current module, and the instances runOnFunction uses in serial mode.
+  std::vector<const CheckerInfo*> FunctionCheckers;
+  CheckerSet Checkers;
+
+  // With -perfTripCounts or -perfProfile, the findings of the function
+  // checkers, listed by weight at the end of the module.
+  // Findings are numbered by their function's position in the module and,
+  // within a function, in the order found.
+  std::vector<Finding> Ranked;
+  llvm::DenseMap<const llvm::Function*, unsigned> FunctionNumbers;
+  uint32_t NumRanked;
+  llvm::sys::Mutex RankedLock;
+  void reportRanked();
+
   std::string intToString(int i);
-  bool getPathAndLineNo(llvm::Instruction *i,
-                        std::string &Path, unsigned &LineNo);
+  void report(const llvm::Function *F, llvm::StringRef Text);
   void getAllocatedType(llvm::AllocaInst *i, std::string &Type);
-  std::vector<std::string> loadSourceFile(std::string s);
-  void addSourceLine(llvm::Instruction *i);
-  std::string getSourceLine(std::string s, unsigned l);
-  void loadSourceFiles(llvm::Module *m);
-  std::list<llvm::Instruction *> searchCallSites(llvm::Function &F,
-                                                 std::string s);
-  llvm::BasicBlock* getLoopHeader(llvm::LoopInfo &li, llvm::Loop *l);
-  bool containsCallSite(llvm::Function &F, const llvm::Function *T);
   bool JumpBackToLoop( llvm::LoopInfo & li , llvm::Loop *l , llvm::BasicBlock * pJumpInst );
-  std::list<const llvm::CallSite*> getCallSitesForFunction(llvm::Function &F,
+  const CallSiteIndex::CallList &getCallSitesForFunction(llvm::Function &F,
                                                      const llvm::Function *T);
   std::list<const llvm::Function*> getFunctionsWithString(llvm::Module &M,
                                                           std::string name);
-  std::string getFunctionName( llvm::CallInst * i);
-  void (PerfEvo::*pBugHandler)(llvm::Function &F);
-  bool bBugHandlerInited;
-  void MozillaBug35294(llvm::Function &F);
-  void MozillaBug66461(llvm::Function &F);
-  void MozillaBug267506(llvm::Function &F);
-  void MozillaBug311566(llvm::Function &F);
-  void MozillaBug103330(llvm::Function &F);
-  void MozillaBug258793(llvm::Function &F);
-  void MozillaBug409961(llvm::Function &F);
-  void MySQLBug26527(llvm::Function &F);
-  void MySQLBug38941(llvm::Function &F);
-
-  void MySQLBug38769(llvm::Function &F);
-
-  void MySQLBug38968(llvm::Function &F);
-  void MySQLBug48229(llvm::Function &F);
-  void MySQLBug38968();
-  void MySQLBug49491(llvm::Function &F);
-  void MySQLBug38824(llvm::Function &F);
-  void MySQLBug14637(llvm::Function &F);
-  void MySQLBug39268(llvm::Function &F);
-  void MySQLBug15811(llvm::Function &F);
-  void ApacheBug33605(llvm::Function &F);
-  void ApacheBug45464(llvm::Function &F);
-  void LoopNestedCallSites(llvm::Function &F);
 public:
   static char ID;
   PerfEvo();
+  /// PerfEvo - Create a pass that reads source lines through Shared, which
+  /// may be used by other PerfEvo instances at the same time, and hands all
+  /// output to Collector.  If SharedCache is given, results are looked up in
+  /// and added to it, but saving it is up to the caller.
+  PerfEvo(SourceCache &Shared, ReportCollector &Collector,
+          AnalysisCache *SharedCache = 0);
+  ~PerfEvo();
   bool doInitialization(llvm::Module &M);
   bool runOnFunction(llvm::Function&);
+  bool doFinalization(llvm::Module &M);
   void getAnalysisUsage(llvm::AnalysisUsage &Info) const;  
+
+  /// getCacheFilename - The file given with -perfCache, or empty.
+  static llvm::StringRef getCacheFilename();
+
+  /// getNumThreads - The number of threads given with -perfThreads, or 1 if
+  /// LLVM cannot run multithreaded.
+  static unsigned getNumThreads();
+
+  /// getSelectedCheckers - The checkers selected with -perfBugID, in the
+  /// order given and without duplicates.
+  static void getSelectedCheckers(std::vector<const CheckerInfo*> &Selected);
+
+  /// getFindingFormat - The format selected with -perfFormat.
+  static FindingFormat getFindingFormat();
+
+  /// writeFinding - Render R in the selected format.  Checkers report
+  /// through CheckerContext::report or reportFinding instead, so findings
+  /// are weighed and ranked.
+  static void writeFinding(const Finding &R, llvm::raw_ostream &Out);
+
+  /// checkFunction - Run the checkers in Set over F and append their output,
+  /// checker by checker, to Output.  Checkers whose output for F is in the
+  /// analysis cache are not run.  Loop information is computed here if LI is
+  /// null and a checker that needs it has to run; SE may be null.  Safe to
+  /// call from several threads at once with different sets.
+  void checkFunction(CheckerSet &Set, llvm::Function &F, BasicLoopInfo *LI,
+                     llvm::ScalarEvolution *SE, std::string &Output);
+
+  /// weighFinding - With -perfProfile, attach the samples of R's line or
+  /// function to R.  Return false if R has fewer than -perfProfileThreshold
+  /// samples and should be dropped.
+  bool weighFinding(Finding &R);
+
+  /// reportFinding - Weigh R and then rank it or write it to Out, as
+  /// CheckerContext::report does.  R was found in F, or by a module scope
+  /// checker if F is null.  Return false if R was dropped.
+  bool reportFinding(Finding &R, const llvm::Function *F,
+                     llvm::raw_ostream &Out);
+
+  /// addRankedFinding - Keep R, found in F or by a module scope checker if
+  /// F is null, to be listed with the others by profile samples and
+  /// estimated dynamic count when the module is done.
+  void addRankedFinding(const Finding &R, const llvm::Function *F);
+
+  /// sortByWeight - Sort Findings by profile samples, then estimated dynamic
+  /// count, then Order, and keep the -perfTop first.
+  static void sortByWeight(std::vector<Finding> &Findings);
+
+  // Services for checkers.
+  llvm::Module &getModule() { return *_M; }
+  TypeNameTable &getTypes() { return Types; }
+  const CallSiteIndex &getCallSites() const { return CallSites; }
+  /// getGlobalUses - The index of global variable uses, built on first
+  /// call.  For module scope checkers only.
+  const GlobalUseIndex &getGlobalUses();
+  bool getLocation(llvm::Instruction *i, SourceLoc &Loc);
+  const std::string &getPath(const SourceLoc &Loc) {
+    return Locations.getPath(Loc.File);
+  }
+  bool getPathAndLineNo(llvm::Instruction *i,
+                        std::string &Path, unsigned &LineNo);
+  std::string getSourceLine(std::string s, unsigned l);
+  llvm::StringRef getSourceLine(const SourceLoc &Loc);
+  /// sourceLineContains - Return true if the source line at Loc contains
+  /// Pattern.  Answered from the token index of the file rather than by
+  /// searching the line.
+  bool sourceLineContains(const SourceLoc &Loc, llvm::StringRef Pattern);
+  std::list<llvm::Instruction *> searchCallSites(llvm::Function &F,
+                                                 std::string s);
+  llvm::BasicBlock* getLoopHeader(BasicLoopInfo &li, llvm::Loop *l);
+  bool containsCallSite(llvm::Function &F, const llvm::Function *T);
+  std::string getFunctionName( llvm::CallInst * i);
 };
 
 #endif	/* _PERFEVO_H */
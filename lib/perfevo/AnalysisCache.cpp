@@ -0,0 +1,183 @@
+//===-AnalysisCache.cpp----------------------------------------------------===//
+//
+// This file implements the persistent cache of per-function checker output.
+//
+//===----------------------------------------------------------------------===//
+
+#include "AnalysisCache.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+namespace {
+struct CacheHeader {
+  char Magic[8];
+  uint32_t Version;
+  uint32_t NumEntries;
+  uint64_t TextSize;
+};
+}
+
+static const char CacheMagic[8] = { 'P', 'E', 'R', 'F', 'E', 'V', 'O', 'C' };
+// Bump whenever the file layout or the meaning of the keys changes.
+static const uint32_t CacheVersion = 2;
+
+AnalysisCache::AnalysisCache(StringRef P)
+  : Path(P), Map(0), MapSize(0), Entries(0), NumEntries(0), Text(0),
+    NumUsed(0) {
+  open();
+  Used.resize(NumEntries);
+}
+
+AnalysisCache::~AnalysisCache() {
+  if (Map)
+    munmap(const_cast<char *>(Map), MapSize);
+}
+
+void AnalysisCache::open() {
+  int FD = ::open(Path.c_str(), O_RDONLY);
+  if (FD < 0)
+    return;
+
+  struct stat Stat;
+  if (fstat(FD, &Stat) != 0 || (size_t)Stat.st_size < sizeof(CacheHeader)) {
+    close(FD);
+    return;
+  }
+
+  void *M = mmap(0, Stat.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+  close(FD);
+  if (M == MAP_FAILED)
+    return;
+
+  // Anything that does not look exactly like a cache we wrote is ignored
+  // and replaced on the next save.
+  const CacheHeader *H = static_cast<const CacheHeader *>(M);
+  uint64_t Expected = sizeof(CacheHeader) +
+                      (uint64_t)H->NumEntries * sizeof(Entry) + H->TextSize;
+  if (memcmp(H->Magic, CacheMagic, sizeof(CacheMagic)) != 0 ||
+      H->Version != CacheVersion || Expected != (uint64_t)Stat.st_size) {
+    munmap(M, Stat.st_size);
+    return;
+  }
+
+  Map = static_cast<const char *>(M);
+  MapSize = Stat.st_size;
+  Entries = reinterpret_cast<const Entry *>(Map + sizeof(CacheHeader));
+  NumEntries = H->NumEntries;
+  Text = reinterpret_cast<const char *>(Entries + NumEntries);
+}
+
+bool AnalysisCache::lookup(uint64_t Key, StringRef &Output) const {
+  const Entry *End = Entries + NumEntries;
+  const Entry *I = std::lower_bound(Entries, End, Key, keyLess);
+  if (I != End && I->Key == Key) {
+    Output = StringRef(Text + I->Offset, I->Length);
+    sys::SmartScopedLock<false> Guard(Lock);
+    if (!Used[I - Entries]) {
+      Used[I - Entries] = true;
+      ++NumUsed;
+    }
+    return true;
+  }
+
+  sys::SmartScopedLock<false> Guard(Lock);
+  std::map<uint64_t, std::string>::const_iterator A = Added.find(Key);
+  if (A == Added.end())
+    return false;
+  Output = A->second;
+  return true;
+}
+
+void AnalysisCache::insert(uint64_t Key, StringRef Output) {
+  // The same key always maps to the same output, so an entry that is
+  // already there is kept; lookup may have handed out references to it.
+  sys::SmartScopedLock<false> Guard(Lock);
+  Added.insert(std::make_pair(Key, Output.str()));
+}
+
+bool AnalysisCache::save(std::string &ErrMsg) {
+  sys::SmartScopedLock<false> Guard(Lock);
+  if (Added.empty() && NumUsed == NumEntries)
+    return true;
+
+  // Merge the old entries used in this run with the new ones; both are
+  // sorted by key.  A new result replaces an old one with the same key.
+  std::vector<std::pair<uint64_t, StringRef> > All;
+  All.reserve(NumUsed + Added.size());
+  const Entry *E = Entries, *EE = Entries + NumEntries;
+  std::map<uint64_t, std::string>::const_iterator A = Added.begin(),
+                                                  AE = Added.end();
+  while (E != EE || A != AE) {
+    if (E != EE && !Used[E - Entries]) {
+      ++E;
+    } else if (A == AE || (E != EE && E->Key < A->first)) {
+      All.push_back(std::make_pair(E->Key,
+                                   StringRef(Text + E->Offset, E->Length)));
+      ++E;
+    } else {
+      if (E != EE && E->Key == A->first)
+        ++E;
+      All.push_back(std::make_pair(A->first, StringRef(A->second)));
+      ++A;
+    }
+  }
+
+  CacheHeader H;
+  memcpy(H.Magic, CacheMagic, sizeof(CacheMagic));
+  H.Version = CacheVersion;
+  H.NumEntries = All.size();
+  H.TextSize = 0;
+
+  std::vector<Entry> NewEntries(All.size());
+  for (unsigned i = 0, e = All.size(); i != e; ++i) {
+    NewEntries[i].Key = All[i].first;
+    NewEntries[i].Offset = H.TextSize;
+    NewEntries[i].Length = All[i].second.size();
+    H.TextSize += All[i].second.size();
+  }
+  if (H.TextSize > UINT32_MAX) {
+    ErrMsg = "analysis cache too large";
+    return false;
+  }
+
+  // Write a new file and move it into place, so readers never see a
+  // partially written cache.
+  std::string TmpPath = Path + ".tmp";
+  {
+    raw_fd_ostream Out(TmpPath.c_str(), ErrMsg, raw_fd_ostream::F_Binary);
+    if (!ErrMsg.empty())
+      return false;
+
+    Out.write(reinterpret_cast<const char *>(&H), sizeof(H));
+    if (!NewEntries.empty())
+      Out.write(reinterpret_cast<const char *>(&NewEntries[0]),
+                NewEntries.size() * sizeof(Entry));
+    for (unsigned i = 0, e = All.size(); i != e; ++i)
+      Out << All[i].second;
+
+    Out.close();
+    if (Out.has_error()) {
+      Out.clear_error();
+      ErrMsg = "error writing " + TmpPath;
+      return false;
+    }
+  }
+
+  if (rename(TmpPath.c_str(), Path.c_str()) != 0) {
+    ErrMsg = "cannot replace " + Path + ": " + strerror(errno);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,90 @@
+//===-BlockReachability.cpp------------------------------------------------===//
+//
+// This file implements the bit-vector reachability queries over the CFG of
+// one function.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BlockReachability.h"
+#include "llvm/Function.h"
+#include "llvm/Instruction.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/CFG.h"
+
+using namespace llvm;
+
+BlockReachability::BlockReachability(Function &F) {
+  for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) {
+    Numbers[b] = Blocks.size();
+    Blocks.push_back(b);
+  }
+
+  Succs.resize(Blocks.size());
+  for (unsigned i = 0, e = Blocks.size(); i != e; ++i)
+    for (succ_iterator s = succ_begin(Blocks[i]), se = succ_end(Blocks[i]);
+         s != se; ++s)
+      Succs[i].push_back(Numbers[*s]);
+}
+
+const BitVector &BlockReachability::getUseBlocks(const Value *V) {
+  BitVector &UB = UseBlocks[V];
+  if (UB.size())
+    return UB;
+
+  UB.resize(Blocks.size());
+  for (Value::const_use_iterator u = V->use_begin(), ue = V->use_end();
+       u != ue; ++u)
+    if (const Instruction *I = dyn_cast<Instruction>(*u)) {
+      DenseMap<const BasicBlock*, unsigned>::const_iterator N =
+        Numbers.find(I->getParent());
+      if (N != Numbers.end())
+        UB.set(N->second);
+    }
+  return UB;
+}
+
+/// getFirstUse - Return the first instruction in [I, E) that uses V.
+static Instruction *getFirstUse(BasicBlock::iterator I, BasicBlock::iterator E,
+                                const Value *V) {
+  for (; I != E; ++I)
+    for (User::op_iterator o = I->op_begin(), oe = I->op_end(); o != oe; ++o)
+      if (o->get() == V)
+        return I;
+  return 0;
+}
+
+void BlockReachability::findNextUses(Instruction *I, const Value *V,
+                                     const BitVector *Skip,
+                                     SmallVectorImpl<Instruction*> &Uses) {
+  BasicBlock *BB = I->getParent();
+  if (Instruction *U = getFirstUse(llvm::next(BasicBlock::iterator(I)),
+                                   BB->end(), V)) {
+    Uses.push_back(U);
+    return;
+  }
+
+  const BitVector &UB = getUseBlocks(V);
+  unsigned Start = getNumber(BB);
+  BitVector Visited(Blocks.size());
+  Visited.set(Start);
+
+  // Depth first, successors in order, like a recursive walk would.
+  SmallVector<unsigned, 16> Worklist(Succs[Start].rbegin(),
+                                     Succs[Start].rend());
+  while (!Worklist.empty()) {
+    unsigned N = Worklist.pop_back_val();
+    if (Visited.test(N))
+      continue;
+    Visited.set(N);
+    if (Skip && Skip->test(N))
+      continue;
+
+    if (UB.test(N))
+      if (Instruction *U = getFirstUse(Blocks[N]->begin(), Blocks[N]->end(),
+                                       V)) {
+        Uses.push_back(U);
+        continue;
+      }
+    Worklist.append(Succs[N].rbegin(), Succs[N].rend());
+  }
+}
@@ -0,0 +1,190 @@
+//===-CallGraphSummary.cpp-------------------------------------------------===//
+//
+// This file implements the bottom-up summaries of which functions reach an
+// expensive call.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallGraphSummary.h"
+#include "CallSiteIndex.h"
+#include "CalleeMatcher.h"
+#include "llvm/Function.h"
+#include "llvm/Instruction.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseSet.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+namespace {
+struct NodeInfo {
+  unsigned Index, Low;
+  bool OnStack;
+};
+
+struct Frame {
+  const Function *F;
+  CallSiteIndex::CalleeMap::const_iterator I, E;
+};
+}
+
+unsigned CallGraphSummary::getMatch(const Function *F) {
+  DenseMap<const Function*, unsigned>::iterator I = Matched.find(F);
+  if (I != Matched.end())
+    return I->second;
+
+  BitVector IDs;
+  Expensive->match(F->getName(), IDs);
+  int First = IDs.find_first();
+  return Matched[F] = First == -1 ? 0 : First + 1;
+}
+
+/// summarize - Summarize the functions of one SCC, whose callees outside
+/// the SCC are all summarized already.  Functions that call an expensive
+/// function or a summarized function outside the SCC are summarized first;
+/// the rest of the SCC is reached from them backwards along the calls inside
+/// the SCC.
+void CallGraphSummary::summarize(const std::vector<const Function*> &SCC) {
+  std::vector<const Function*> Worklist;
+  for (unsigned i = 0, e = SCC.size(); i != e; ++i) {
+    const Function *F = SCC[i];
+    if (getMatch(F))
+      continue;
+
+    Summary Best;
+    const CallSiteIndex::CalleeMap &Callees = CallSites->getCallees(F);
+    for (CallSiteIndex::CalleeMap::const_iterator I = Callees.begin(),
+         E = Callees.end(); I != E; ++I) {
+      Summary S;
+      if (unsigned P = getMatch(I->first)) {
+        S.Pattern = P - 1;
+        S.Depth = 1;
+      } else if (const Summary *CS = getSummary(I->first)) {
+        S.Pattern = CS->Pattern;
+        S.Depth = CS->Depth + 1;
+      } else {
+        continue;
+      }
+      if (Best.Depth && Best.Depth <= S.Depth)
+        continue;
+      S.Witness = I->second.front();
+      Best = S;
+    }
+    if (Best.Depth) {
+      Summaries[F] = Best;
+      Worklist.push_back(F);
+    }
+  }
+
+  if (SCC.size() == 1)
+    return;
+  DenseSet<const Function*> InSCC;
+  for (unsigned i = 0, e = SCC.size(); i != e; ++i)
+    InSCC.insert(SCC[i]);
+  for (unsigned q = 0; q != Worklist.size(); ++q) {
+    const Function *G = Worklist[q];
+    const Summary GS = Summaries[G];
+    const CallSiteIndex::CallList &Calls = CallSites->getCallSites(G);
+    for (unsigned i = 0, e = Calls.size(); i != e; ++i) {
+      const Function *F = Calls[i]->getParent()->getParent();
+      if (!InSCC.count(F) || Summaries.count(F) || getMatch(F))
+        continue;
+      Summary &S = Summaries[F];
+      S.Witness = Calls[i];
+      S.Pattern = GS.Pattern;
+      S.Depth = GS.Depth + 1;
+      Worklist.push_back(F);
+    }
+  }
+}
+
+void CallGraphSummary::build(Module &M, const CallSiteIndex &CS,
+                             const CalleeMatcher &E) {
+  CallSites = &CS;
+  Expensive = &E;
+  Matched.clear();
+  Summaries.clear();
+
+  // Tarjan's algorithm without recursion.  SCCs are completed callees
+  // first, which is the order they have to be summarized in.
+  DenseMap<const Function*, NodeInfo> Nodes;
+  std::vector<const Function*> Stack;
+  std::vector<Frame> Frames;
+  std::vector<const Function*> SCC;
+
+  for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f) {
+    if (f->isDeclaration() || Nodes.count(f))
+      continue;
+
+    const Function *Root = f;
+    NodeInfo &RootInfo = Nodes[Root];
+    RootInfo.Index = RootInfo.Low = Nodes.size() - 1;
+    RootInfo.OnStack = true;
+    Stack.push_back(Root);
+    const CallSiteIndex::CalleeMap &RootCallees = CS.getCallees(Root);
+    Frame RootFrame = { Root, RootCallees.begin(), RootCallees.end() };
+    Frames.push_back(RootFrame);
+
+    while (!Frames.empty()) {
+      Frame &Top = Frames.back();
+      if (Top.I != Top.E) {
+        const Function *G = Top.I->first;
+        ++Top.I;
+        if (G->isDeclaration())
+          continue;
+
+        DenseMap<const Function*, NodeInfo>::iterator N = Nodes.find(G);
+        if (N == Nodes.end()) {
+          NodeInfo &GInfo = Nodes[G];
+          GInfo.Index = GInfo.Low = Nodes.size() - 1;
+          GInfo.OnStack = true;
+          Stack.push_back(G);
+          const CallSiteIndex::CalleeMap &Callees = CS.getCallees(G);
+          Frame GFrame = { G, Callees.begin(), Callees.end() };
+          Frames.push_back(GFrame);
+        } else if (N->second.OnStack) {
+          NodeInfo &FInfo = Nodes[Top.F];
+          FInfo.Low = std::min(FInfo.Low, N->second.Index);
+        }
+        continue;
+      }
+
+      const Function *F = Top.F;
+      Frames.pop_back();
+      NodeInfo FInfo = Nodes[F];
+      if (!Frames.empty()) {
+        NodeInfo &Parent = Nodes[Frames.back().F];
+        Parent.Low = std::min(Parent.Low, FInfo.Low);
+      }
+      if (FInfo.Low != FInfo.Index)
+        continue;
+
+      SCC.clear();
+      const Function *G;
+      do {
+        G = Stack.back();
+        Stack.pop_back();
+        Nodes[G].OnStack = false;
+        SCC.push_back(G);
+      } while (G != F);
+      summarize(SCC);
+    }
+  }
+}
+
+const CallGraphSummary::Summary *
+CallGraphSummary::getSummary(const Function *F) const {
+  DenseMap<const Function*, Summary>::const_iterator I = Summaries.find(F);
+  return I == Summaries.end() ? 0 : &I->second;
+}
+
+void CallGraphSummary::getWitnessPath(const Function *F,
+                                      SmallVectorImpl<Instruction*> &Path)
+  const {
+  while (const Summary *S = getSummary(F)) {
+    Path.push_back(S->Witness);
+    F = CallSiteIndex::getCallee(S->Witness);
+  }
+}
@@ -0,0 +1,73 @@
+//===-CallSiteIndex.cpp----------------------------------------------------===//
+//
+// This file implements the module-wide callee to call site index.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CallSiteIndex.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalAlias.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+
+using namespace llvm;
+
+const Function *CallSiteIndex::getCallee(const Instruction *I) {
+  const Value *V;
+  if (const CallInst *CI = dyn_cast<CallInst>(I))
+    V = CI->getCalledValue();
+  else if (const InvokeInst *II = dyn_cast<InvokeInst>(I))
+    V = II->getCalledValue();
+  else
+    return 0;
+
+  V = V->stripPointerCasts();
+  if (const GlobalAlias *GA = dyn_cast<GlobalAlias>(V))
+    V = GA->resolveAliasedGlobal(false);
+  return dyn_cast_or_null<Function>(V);
+}
+
+void CallSiteIndex::build(Module &M) {
+  clear();
+  for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f) {
+    if (f->isDeclaration())
+      continue;
+
+    CalleeMap *FunctionCalls = 0;
+    for (Function::iterator b = f->begin(), be = f->end(); b != be; ++b)
+      for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
+        const Function *Callee = getCallee(i);
+        if (!Callee)
+          continue;
+        if (!FunctionCalls)
+          FunctionCalls = &Calls[f];
+        (*FunctionCalls)[Callee].push_back(i);
+        Callers[Callee].push_back(i);
+      }
+  }
+}
+
+void CallSiteIndex::clear() {
+  Callers.clear();
+  Calls.clear();
+}
+
+const CallSiteIndex::CallList &
+CallSiteIndex::getCallSites(const Function *Callee) const {
+  CalleeMap::const_iterator I = Callers.find(Callee);
+  return I == Callers.end() ? NoCalls : I->second;
+}
+
+const CallSiteIndex::CallList &
+CallSiteIndex::getCallSites(const Function *Caller,
+                            const Function *Callee) const {
+  const CalleeMap &Callees = getCallees(Caller);
+  CalleeMap::const_iterator I = Callees.find(Callee);
+  return I == Callees.end() ? NoCalls : I->second;
+}
+
+const CallSiteIndex::CalleeMap &
+CallSiteIndex::getCallees(const Function *Caller) const {
+  DenseMap<const Function*, CalleeMap>::const_iterator I = Calls.find(Caller);
+  return I == Calls.end() ? NoCallees : I->second;
+}
@@ -0,0 +1,109 @@
+//===-CalleeMatcher.cpp----------------------------------------------------===//
+//
+// This file implements the Aho-Corasick automaton behind the callee name
+// triggers of the checkers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CalleeMatcher.h"
+#include "llvm/ADT/BitVector.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace llvm;
+
+/// getNext - Return the state reached on C, or 0 if there is no transition.
+unsigned CalleeMatcher::State::getNext(unsigned char C) const {
+  std::vector<std::pair<unsigned char, unsigned> >::const_iterator I =
+    std::lower_bound(Next.begin(), Next.end(), std::make_pair(C, 0u));
+  return I != Next.end() && I->first == C ? I->second : 0;
+}
+
+CalleeMatcher::CalleeMatcher() : States(1), NumIDs(0), Compiled(true) {}
+
+void CalleeMatcher::clear() {
+  States.assign(1, State());
+  NumIDs = 0;
+  Compiled = true;
+}
+
+void CalleeMatcher::add(StringRef Pattern, unsigned ID) {
+  assert(!Pattern.empty() && "Empty pattern matches every name");
+  unsigned S = 0;
+  for (unsigned i = 0, e = Pattern.size(); i != e; ++i) {
+    unsigned char C = Pattern[i];
+    unsigned N = States[S].getNext(C);
+    if (!N) {
+      N = States.size();
+      std::vector<std::pair<unsigned char, unsigned> > &Next = States[S].Next;
+      Next.insert(std::lower_bound(Next.begin(), Next.end(),
+                                   std::make_pair(C, 0u)),
+                  std::make_pair(C, N));
+      States.push_back(State());
+    }
+    S = N;
+  }
+  if (std::find(States[S].IDs.begin(), States[S].IDs.end(), ID) ==
+      States[S].IDs.end())
+    States[S].IDs.push_back(ID);
+  NumIDs = std::max(NumIDs, ID + 1);
+  Compiled = false;
+}
+
+void CalleeMatcher::compile() {
+  if (Compiled)
+    return;
+
+  // Breadth first, so the fail state of every state is done before it.
+  // Patterns added since the last compile may have added children to states
+  // that were already linked, so everything is linked again.
+  std::vector<unsigned> Queue;
+  const State &Root = States[0];
+  for (unsigned i = 0, e = Root.Next.size(); i != e; ++i) {
+    States[Root.Next[i].second].Fail = 0;
+    Queue.push_back(Root.Next[i].second);
+  }
+
+  for (unsigned q = 0; q != Queue.size(); ++q) {
+    unsigned S = Queue[q];
+    for (unsigned i = 0, e = States[S].Next.size(); i != e; ++i) {
+      unsigned char C = States[S].Next[i].first;
+      unsigned N = States[S].Next[i].second;
+
+      unsigned F = States[S].Fail;
+      while (F && !States[F].getNext(C))
+        F = States[F].Fail;
+      F = States[F].getNext(C);
+      States[N].Fail = F;
+
+      // A name containing this state's pattern also contains the fail
+      // state's, so its IDs are reported too.
+      for (unsigned j = 0, je = States[F].IDs.size(); j != je; ++j) {
+        unsigned ID = States[F].IDs[j];
+        if (std::find(States[N].IDs.begin(), States[N].IDs.end(), ID) ==
+            States[N].IDs.end())
+          States[N].IDs.push_back(ID);
+      }
+      Queue.push_back(N);
+    }
+  }
+  Compiled = true;
+}
+
+void CalleeMatcher::match(StringRef Name, BitVector &IDs) const {
+  assert(Compiled && "Patterns added since the last compile");
+  if (IDs.size() < NumIDs)
+    IDs.resize(NumIDs);
+
+  unsigned S = 0;
+  for (unsigned i = 0, e = Name.size(); i != e; ++i) {
+    unsigned char C = Name[i];
+    unsigned N;
+    while (!(N = States[S].getNext(C)) && S)
+      S = States[S].Fail;
+    S = N;
+    for (unsigned j = 0, je = States[S].IDs.size(); j != je; ++j)
+      IDs.set(States[S].IDs[j]);
+  }
+}
@@ -0,0 +1,35 @@
+//===-CheckerRegistry.cpp--------------------------------------------------===//
+//
+// This file implements the registry checkers add themselves to.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PerfEvoChecker.h"
+
+using namespace llvm;
+
+// Checkers register from static constructors in other translation units, so
+// the list is created on first use rather than being a plain global.
+static std::vector<const CheckerInfo*> &getCheckers() {
+  static std::vector<const CheckerInfo*> Checkers;
+  return Checkers;
+}
+
+void CheckerRegistry::add(const CheckerInfo *Info) {
+  getCheckers().push_back(Info);
+}
+
+const CheckerInfo *CheckerRegistry::lookup(StringRef ID) {
+  for (iterator I = begin(), E = end(); I != E; ++I)
+    if (ID == (*I)->ID)
+      return *I;
+  return 0;
+}
+
+CheckerRegistry::iterator CheckerRegistry::begin() {
+  return getCheckers().begin();
+}
+
+CheckerRegistry::iterator CheckerRegistry::end() {
+  return getCheckers().end();
+}
@@ -0,0 +1,192 @@
+//===-CheckerSet.cpp-------------------------------------------------------===//
+//
+// This file implements the per-function instruction dispatch to checkers.
+//
+//===----------------------------------------------------------------------===//
+
+#include "CheckerSet.h"
+#include "CallSiteIndex.h"
+#include "llvm/Function.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/Instructions.h"
+
+#include <algorithm>
+
+using namespace llvm;
+
+CheckerSet::CheckerSet()
+  : OpcodeCheckers(Instruction::OtherOpsEnd), Analyses(NoAnalyses),
+    Stats(0) {}
+
+CheckerSet::~CheckerSet() {
+  clear();
+}
+
+void CheckerSet::add(const CheckerInfo *Info) {
+  PerfEvoChecker *C = Info->Create(*Info);
+  Checkers.push_back(C);
+  Infos.push_back(Info);
+  Interests.push_back(CheckerInterest());
+  CheckerInterest &I = Interests.back();
+  C->getInterest(I);
+  Analyses |= Info->Analyses;
+
+  unsigned Idx = Checkers.size() - 1;
+  if (I.AllInstructions) {
+    AllInstCheckers.push_back(Idx);
+    return;
+  }
+  for (unsigned i = 0, e = I.Opcodes.size(); i != e; ++i)
+    OpcodeCheckers[I.Opcodes[i]].push_back(Idx);
+
+  // Checkers that already see every call by opcode are not triggered, so
+  // they are not visited twice.
+  if (!Info->Triggers ||
+      std::count(I.Opcodes.begin(), I.Opcodes.end(),
+                 (unsigned)Instruction::Call) ||
+      std::count(I.Opcodes.begin(), I.Opcodes.end(),
+                 (unsigned)Instruction::Invoke))
+    return;
+  for (const char *const *T = Info->Triggers; *T; ++T)
+    Triggers.add(*T, Idx);
+  CalleeCheckers.clear();
+}
+
+void CheckerSet::clear() {
+  for (unsigned i = 0, e = Checkers.size(); i != e; ++i)
+    delete Checkers[i];
+  Checkers.clear();
+  Infos.clear();
+  Interests.clear();
+  for (unsigned i = 0, e = OpcodeCheckers.size(); i != e; ++i)
+    OpcodeCheckers[i].clear();
+  AllInstCheckers.clear();
+  Triggers.clear();
+  CalleeCheckers.clear();
+  Analyses = NoAnalyses;
+}
+
+void CheckerSet::visit(unsigned Idx, Instruction *I, PerfEvo &Pass,
+                       Function &F, BasicLoopInfo *LI, ScalarEvolution *SE,
+                       const std::vector<raw_ostream*> &Outs) {
+  if (!Outs[Idx])
+    return;
+  CheckerContext C(Pass, Infos[Idx]->ID, F, LI, SE, *Outs[Idx]);
+  if (!Stats) {
+    Checkers[Idx]->visit(I, C);
+    return;
+  }
+
+  CheckerCounters &CC = Counters[Idx];
+  StatsTimer T;
+  Checkers[Idx]->visit(I, C);
+  double Wall, CPU;
+  T.getElapsed(Wall, CPU);
+  CC.Wall += Wall;
+  CC.CPU += CPU;
+  ++CC.Visited;
+  CC.Findings += C.NumFindings;
+}
+
+void CheckerSet::beginFunction(unsigned Idx, CheckerContext &C) {
+  if (!Stats) {
+    Checkers[Idx]->beginFunction(C);
+    return;
+  }
+
+  StatsTimer T;
+  Checkers[Idx]->beginFunction(C);
+  double Wall, CPU;
+  T.getElapsed(Wall, CPU);
+  Counters[Idx].Wall += Wall;
+  Counters[Idx].CPU += CPU;
+}
+
+void CheckerSet::endFunction(unsigned Idx, CheckerContext &C) {
+  if (!Stats) {
+    Checkers[Idx]->endFunction(C);
+    return;
+  }
+
+  StatsTimer T;
+  Checkers[Idx]->endFunction(C);
+  double Wall, CPU;
+  T.getElapsed(Wall, CPU);
+  Counters[Idx].Wall += Wall;
+  Counters[Idx].CPU += CPU;
+  Counters[Idx].Findings += C.NumFindings;
+}
+
+/// getCalleeCheckers - Return the checkers triggered by calls to Callee.
+/// The answer only depends on the callee's name, so the name is run through
+/// the trigger automaton once per callee and later calls are a lookup.
+const CheckerSet::CheckerList &
+CheckerSet::getCalleeCheckers(const Function *Callee) {
+  DenseMap<const Function*, CheckerList>::iterator I =
+    CalleeCheckers.find(Callee);
+  if (I != CalleeCheckers.end())
+    return I->second;
+
+  CheckerList &L = CalleeCheckers[Callee];
+  if (Triggers.empty())
+    return L;
+  BitVector Matched(Checkers.size());
+  Triggers.match(Callee->getName(), Matched);
+  for (int i = Matched.find_first(); i != -1; i = Matched.find_next(i))
+    L.push_back(i);
+  return L;
+}
+
+void CheckerSet::run(PerfEvo &Pass, Function &F, BasicLoopInfo *LI,
+                     ScalarEvolution *SE,
+                     const std::vector<raw_ostream*> &Outs) {
+  Triggers.compile();
+  Stats = PerfStats::get();
+  if (Stats)
+    Counters.assign(Checkers.size(), CheckerCounters());
+  uint64_t NumInsts = 0;
+
+  for (unsigned i = 0, e = Checkers.size(); i != e; ++i)
+    if (Outs[i]) {
+      CheckerContext C(Pass, Infos[i]->ID, F, LI, SE, *Outs[i]);
+      beginFunction(i, C);
+    }
+
+  for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) {
+    for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
+      Instruction *I = i;
+      ++NumInsts;
+
+      for (unsigned k = 0, ke = AllInstCheckers.size(); k != ke; ++k)
+        visit(AllInstCheckers[k], I, Pass, F, LI, SE, Outs);
+
+      const CheckerList &OL = OpcodeCheckers[I->getOpcode()];
+      for (unsigned k = 0, ke = OL.size(); k != ke; ++k)
+        visit(OL[k], I, Pass, F, LI, SE, Outs);
+
+      if (!isa<CallInst>(I) && !isa<InvokeInst>(I))
+        continue;
+      if (const Function *Callee = CallSiteIndex::getCallee(I)) {
+        const CheckerList &CL = getCalleeCheckers(Callee);
+        for (unsigned k = 0, ke = CL.size(); k != ke; ++k) {
+          if (Stats && Outs[CL[k]])
+            ++Counters[CL[k]].CallsMatched;
+          visit(CL[k], I, Pass, F, LI, SE, Outs);
+        }
+      }
+    }
+  }
+
+  for (unsigned i = 0, e = Checkers.size(); i != e; ++i)
+    if (Outs[i]) {
+      CheckerContext C(Pass, Infos[i]->ID, F, LI, SE, *Outs[i]);
+      endFunction(i, C);
+    }
+
+  if (!Stats)
+    return;
+  Stats->addInstructionsWalked(NumInsts);
+  for (unsigned i = 0, e = Checkers.size(); i != e; ++i)
+    if (Outs[i])
+      Stats->addFunction(Infos[i]->ID, F.getName(), Counters[i]);
+}
@@ -0,0 +1,154 @@
+//===-Dataflow.cpp---------------------------------------------------------===//
+//
+// This file implements the worklist solver for bit-vector dataflow problems.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Dataflow.h"
+#include "llvm/Function.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/CommandLine.h"
+
+using namespace llvm;
+
+static cl::opt<unsigned> VisitLimit("perfDataflowLimit",
+       cl::desc("Give up a dataflow problem after this many visits per block"),
+       cl::init(50), cl::value_desc("N"));
+
+unsigned DataflowSolver::getVisitLimit() {
+  return VisitLimit;
+}
+
+void DataflowSolver::meet(BitVector &V, const BitVector &In,
+                          bool First) const {
+  if (First)
+    V = In;
+  else if (P.getMeet() == DataflowProblem::Union)
+    V |= In;
+  else
+    V &= In;
+}
+
+bool DataflowSolver::solve(Function &F) {
+  Order.clear();
+  Numbers.clear();
+  Visits = 0;
+  Converged = false;
+  if (F.isDeclaration())
+    return Converged = true;
+
+  bool Forward = P.getDirection() == DataflowProblem::Forward;
+  if (Forward) {
+    ReversePostOrderTraversal<Function*> RPOT(&F);
+    for (ReversePostOrderTraversal<Function*>::rpo_iterator
+         I = RPOT.begin(), E = RPOT.end(); I != E; ++I)
+      Order.push_back(*I);
+  } else {
+    for (po_iterator<Function*> I = po_begin(&F), E = po_end(&F); I != E; ++I)
+      Order.push_back(*I);
+  }
+  for (unsigned i = 0, e = Order.size(); i != e; ++i)
+    Numbers[Order[i]] = i;
+
+  // Start every block at the top of the lattice: nothing for Union, so the
+  // values grow, everything for Intersection, so they shrink.
+  unsigned NumBits = P.getNumBits();
+  BitVector Top(NumBits, P.getMeet() == DataflowProblem::Intersection);
+  BitVector Boundary(NumBits);
+  P.getBoundary(Boundary);
+  Empty.clear();
+  Empty.resize(NumBits);
+  Begin.assign(Order.size(), Top);
+  End.assign(Order.size(), Top);
+
+  unsigned Limit = VisitLimit * Order.size();
+  BitVector Pending(Order.size(), true);
+  BitVector V;
+  for (int i = Pending.find_first(); i != -1; i = Pending.find_first()) {
+    Pending.reset(i);
+    if (++Visits > Limit)
+      return false;
+
+    BasicBlock *BB = Order[i];
+    bool First = true;
+    if (Forward) {
+      if (BB == &F.getEntryBlock()) {
+        meet(V, Boundary, First);
+        First = false;
+      }
+      for (pred_iterator p = pred_begin(BB), pe = pred_end(BB); p != pe; ++p) {
+        DenseMap<const BasicBlock*, unsigned>::iterator N = Numbers.find(*p);
+        if (N == Numbers.end())
+          continue;
+        meet(V, End[N->second], First);
+        First = false;
+      }
+    } else {
+      if (succ_begin(BB) == succ_end(BB)) {
+        meet(V, Boundary, First);
+        First = false;
+      }
+      for (succ_iterator s = succ_begin(BB), se = succ_end(BB); s != se; ++s) {
+        DenseMap<const BasicBlock*, unsigned>::iterator N = Numbers.find(*s);
+        if (N == Numbers.end())
+          continue;
+        meet(V, Begin[N->second], First);
+        First = false;
+      }
+    }
+    if (First)
+      V = Top;
+
+    if (Forward) {
+      Begin[i] = V;
+      for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I)
+        P.transfer(I, V);
+      if (V == End[i])
+        continue;
+      End[i] = V;
+      for (succ_iterator s = succ_begin(BB), se = succ_end(BB); s != se; ++s)
+        Pending.set(Numbers[*s]);
+    } else {
+      End[i] = V;
+      for (BasicBlock::iterator I = BB->end(), E = BB->begin(); I != E; )
+        P.transfer(--I, V);
+      if (V == Begin[i])
+        continue;
+      Begin[i] = V;
+      for (pred_iterator p = pred_begin(BB), pe = pred_end(BB); p != pe; ++p) {
+        DenseMap<const BasicBlock*, unsigned>::iterator N = Numbers.find(*p);
+        if (N != Numbers.end())
+          Pending.set(N->second);
+      }
+    }
+  }
+  return Converged = true;
+}
+
+const BitVector &DataflowSolver::getBlockBegin(const BasicBlock *BB) const {
+  DenseMap<const BasicBlock*, unsigned>::const_iterator N = Numbers.find(BB);
+  return N == Numbers.end() ? Empty : Begin[N->second];
+}
+
+const BitVector &DataflowSolver::getBlockEnd(const BasicBlock *BB) const {
+  DenseMap<const BasicBlock*, unsigned>::const_iterator N = Numbers.find(BB);
+  return N == Numbers.end() ? Empty : End[N->second];
+}
+
+void DataflowSolver::getInput(Instruction *I, BitVector &V) const {
+  BasicBlock *BB = I->getParent();
+  if (P.getDirection() == DataflowProblem::Forward) {
+    V = getBlockBegin(BB);
+    if (!Numbers.count(BB))
+      return;
+    for (BasicBlock::iterator i = BB->begin(); &*i != I; ++i)
+      P.transfer(i, V);
+  } else {
+    V = getBlockEnd(BB);
+    if (!Numbers.count(BB))
+      return;
+    for (BasicBlock::iterator i = BB->end(); &*--i != I; )
+      P.transfer(i, V);
+  }
+}
@@ -0,0 +1,261 @@
+//===-Finding.cpp----------------------------------------------------------===//
+//
+// This file implements the text, JSON Lines and SARIF renderings of checker
+// findings.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Finding.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+/// getUTF8Length - The length of the well-formed UTF-8 sequence that starts
+/// at S[i], or zero if the bytes there are not one.
+static unsigned getUTF8Length(StringRef S, unsigned i) {
+  unsigned char c = S[i];
+  unsigned Length;
+  // The range allowed for the second byte excludes overlong forms,
+  // surrogates and code points past U+10FFFF.
+  unsigned char Low = 0x80, High = 0xBF;
+  if (c >= 0xC2 && c <= 0xDF)
+    Length = 2;
+  else if (c >= 0xE0 && c <= 0xEF)
+    Length = 3;
+  else if (c >= 0xF0 && c <= 0xF4)
+    Length = 4;
+  else
+    return 0;
+  if (c == 0xE0)
+    Low = 0xA0;
+  else if (c == 0xED)
+    High = 0x9F;
+  else if (c == 0xF0)
+    Low = 0x90;
+  else if (c == 0xF4)
+    High = 0x8F;
+
+  if (i + Length > S.size())
+    return 0;
+  for (unsigned k = 1; k != Length; ++k) {
+    unsigned char t = S[i + k];
+    if (k == 1 ? t < Low || t > High : t < 0x80 || t > 0xBF)
+      return 0;
+  }
+  return Length;
+}
+
+void writeJSONString(raw_ostream &OS, StringRef S) {
+  OS << '"';
+  for (unsigned i = 0, e = S.size(); i != e; ++i) {
+    unsigned char c = S[i];
+    // Paths and source lines need not be UTF-8; JSON text must be.
+    if (c >= 0x80) {
+      if (unsigned Length = getUTF8Length(S, i)) {
+        OS << S.substr(i, Length);
+        i += Length - 1;
+      } else {
+        OS << "\\ufffd";
+      }
+      continue;
+    }
+    switch (c) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\r': OS << "\\r"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (c < 0x20) {
+        OS << "\\u00";
+        OS.write_hex(c >> 4);
+        OS.write_hex(c & 0xF);
+      } else {
+        OS << c;
+      }
+    }
+  }
+  OS << '"';
+}
+
+static void writeText(const Finding &R, raw_ostream &OS) {
+  const FindingLoc &L = R.Loc;
+  if (L.File.empty())
+    OS << "<unknown>";
+  else
+    OS << L.File << ':' << L.Line;
+  OS << ": " << R.Checker;
+  if (!R.Function.empty())
+    OS << " in " << R.Function;
+  if (!R.Message.empty())
+    OS << ": " << R.Message;
+  if (R.LoopDepth) {
+    OS << " (loop depth " << R.LoopDepth;
+    if (R.EstimatedCount)
+      OS << ", trip count " << R.TripCount << " ~ "
+         << format("%.0f", R.EstimatedCount);
+    OS << ')';
+  }
+  if (R.Profiled)
+    OS << " [" << R.Samples << " samples]";
+  OS << '\n';
+  if (!L.Source.empty())
+    OS << '\t' << L.Source << '\n';
+
+  for (unsigned i = 0, e = R.Related.size(); i != e; ++i) {
+    const FindingLoc &RL = R.Related[i];
+    OS << RL.File << ':' << RL.Line << ": note";
+    if (!RL.Note.empty())
+      OS << ": " << RL.Note;
+    OS << '\n';
+    if (!RL.Source.empty())
+      OS << '\t' << RL.Source << '\n';
+  }
+}
+
+static void writeJSONLoc(const FindingLoc &L, raw_ostream &OS) {
+  OS << "{\"file\":";
+  writeJSONString(OS, L.File);
+  OS << ",\"line\":" << L.Line << ",\"source\":";
+  writeJSONString(OS, L.Source);
+  if (!L.Note.empty()) {
+    OS << ",\"note\":";
+    writeJSONString(OS, L.Note);
+  }
+  OS << '}';
+}
+
+static void writeJSONLines(const Finding &R, raw_ostream &OS) {
+  OS << "{\"checker\":";
+  writeJSONString(OS, R.Checker);
+  OS << ",\"function\":";
+  writeJSONString(OS, R.Function);
+  OS << ",\"file\":";
+  writeJSONString(OS, R.Loc.File);
+  OS << ",\"line\":" << R.Loc.Line << ",\"source\":";
+  writeJSONString(OS, R.Loc.Source);
+  OS << ",\"loopDepth\":" << R.LoopDepth;
+  if (R.EstimatedCount) {
+    OS << ",\"tripCount\":";
+    writeJSONString(OS, R.TripCount);
+    OS << ",\"estimatedCount\":" << format("%.0f", R.EstimatedCount);
+  }
+  if (R.Profiled)
+    OS << ",\"samples\":" << R.Samples;
+  OS << ",\"message\":";
+  writeJSONString(OS, R.Message);
+  OS << ",\"related\":[";
+  for (unsigned i = 0, e = R.Related.size(); i != e; ++i) {
+    if (i)
+      OS << ',';
+    writeJSONLoc(R.Related[i], OS);
+  }
+  OS << "]}\n";
+}
+
+/// writeSARIFLoc - Write a SARIF location object.  Positions without a file
+/// only carry the message.
+static void writeSARIFLoc(const FindingLoc &L, StringRef Function,
+                          raw_ostream &OS) {
+  OS << '{';
+  if (!L.File.empty()) {
+    OS << "\"physicalLocation\":{\"artifactLocation\":{\"uri\":";
+    writeJSONString(OS, "file://" + L.File);
+    OS << "},\"region\":{\"startLine\":" << L.Line;
+    if (!L.Source.empty()) {
+      OS << ",\"snippet\":{\"text\":";
+      writeJSONString(OS, L.Source);
+      OS << '}';
+    }
+    OS << "}}";
+  }
+  if (!Function.empty()) {
+    if (!L.File.empty())
+      OS << ',';
+    OS << "\"logicalLocations\":[{\"name\":";
+    writeJSONString(OS, Function);
+    OS << ",\"kind\":\"function\"}]";
+  }
+  if (!L.Note.empty()) {
+    if (!L.File.empty() || !Function.empty())
+      OS << ',';
+    OS << "\"message\":{\"text\":";
+    writeJSONString(OS, L.Note);
+    OS << '}';
+  }
+  OS << '}';
+}
+
+static void writeSARIF(const Finding &R, raw_ostream &OS) {
+  OS << "{\"ruleId\":";
+  writeJSONString(OS, R.Checker);
+  OS << ",\"message\":{\"text\":";
+  writeJSONString(OS, R.Message.empty() ? R.Checker : R.Message);
+  OS << "},\"locations\":[";
+  writeSARIFLoc(R.Loc, R.Function, OS);
+  OS << ']';
+  if (!R.Related.empty()) {
+    OS << ",\"relatedLocations\":[";
+    for (unsigned i = 0, e = R.Related.size(); i != e; ++i) {
+      if (i)
+        OS << ',';
+      writeSARIFLoc(R.Related[i], StringRef(), OS);
+    }
+    OS << ']';
+  }
+  OS << ",\"properties\":{\"loopDepth\":" << R.LoopDepth;
+  if (R.EstimatedCount) {
+    OS << ",\"tripCount\":";
+    writeJSONString(OS, R.TripCount);
+    OS << ",\"estimatedCount\":" << format("%.0f", R.EstimatedCount);
+  }
+  if (R.Profiled)
+    OS << ",\"samples\":" << R.Samples;
+  OS << "}}\n";
+}
+
+void writeFinding(const Finding &R, FindingFormat Format, raw_ostream &OS) {
+  switch (Format) {
+  case TextFormat:      writeText(R, OS); break;
+  case JSONLinesFormat: writeJSONLines(R, OS); break;
+  case SARIFFormat:     writeSARIF(R, OS); break;
+  }
+}
+
+FindingsWriter::FindingsWriter(raw_ostream &O, FindingFormat F)
+  : OS(O), Format(F), NeedComma(false), Finished(false) {
+  if (Format == SARIFFormat)
+    OS << "{\"version\":\"2.1.0\",\"$schema\":"
+          "\"https://json.schemastore.org/sarif-2.1.0.json\","
+          "\"runs\":[{\"tool\":{\"driver\":{\"name\":\"perfevo\"}},"
+          "\"results\":[\n";
+}
+
+void FindingsWriter::write(StringRef Records) {
+  if (Format != SARIFFormat) {
+    OS << Records;
+    return;
+  }
+
+  // SARIF results are array elements, so they need separating commas.
+  while (!Records.empty()) {
+    std::pair<StringRef, StringRef> Split = Records.split('\n');
+    if (!Split.first.empty()) {
+      if (NeedComma)
+        OS << ",\n";
+      OS << Split.first;
+      NeedComma = true;
+    }
+    Records = Split.second;
+  }
+}
+
+void FindingsWriter::finish() {
+  if (Finished)
+    return;
+  Finished = true;
+  if (Format == SARIFFormat)
+    OS << "\n]}]}\n";
+  OS.flush();
+}
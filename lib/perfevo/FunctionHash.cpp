@@ -0,0 +1,204 @@
+//===-FunctionHash.cpp-----------------------------------------------------===//
+//
+// This file implements the structural function fingerprints used to key the
+// analysis cache.
+//
+//===----------------------------------------------------------------------===//
+
+#include "FunctionHash.h"
+#include "LocationCache.h"
+#include "TypeNameTable.h"
+#include "llvm/Constants.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/InlineAsm.h"
+#include "llvm/Instructions.h"
+#include "llvm/Metadata.h"
+#include "llvm/Module.h"
+#include "llvm/Support/DebugLoc.h"
+#include "llvm/TypeSymbolTable.h"
+
+using namespace llvm;
+
+namespace {
+// Tags keep different kinds of operands with the same payload apart.
+enum ValueTag {
+  LocalTag = 1,
+  GlobalTag,
+  IntTag,
+  FPTag,
+  ExprTag,
+  AggregateTag,
+  SimpleConstantTag,
+  MDStringTag,
+  MDNodeTag,
+  AsmTag,
+  NoLocTag
+};
+}
+
+void FunctionHasher::addType(FNVHash &H, const Type *T) {
+  H.add(Types.getName(T));
+}
+
+void FunctionHasher::addValue(FNVHash &H, const Value *V) {
+  DenseMap<const Value*, unsigned>::iterator I = Numbers.find(V);
+  if (I != Numbers.end()) {
+    H.add(LocalTag);
+    H.add(I->second);
+    return;
+  }
+
+  if (const GlobalValue *GV = dyn_cast<GlobalValue>(V)) {
+    H.add(GlobalTag);
+    H.add(GV->getName());
+    // The contents of a constant, such as a format string, are as much part
+    // of the code as its name.  Each constant is hashed once per function,
+    // which also ends cycles through initializers.
+    const GlobalVariable *Var = dyn_cast<GlobalVariable>(GV);
+    if (Var && Var->isConstant() && Var->hasDefinitiveInitializer() &&
+        HashedGlobals.insert(Var).second)
+      addValue(H, Var->getInitializer());
+    return;
+  }
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(V)) {
+    H.add(IntTag);
+    addType(H, CI->getType());
+    const APInt &Val = CI->getValue();
+    H.add(Val.getRawData(), Val.getNumWords() * sizeof(uint64_t));
+    return;
+  }
+  if (const ConstantFP *CFP = dyn_cast<ConstantFP>(V)) {
+    H.add(FPTag);
+    addType(H, CFP->getType());
+    APInt Bits = CFP->getValueAPF().bitcastToAPInt();
+    H.add(Bits.getRawData(), Bits.getNumWords() * sizeof(uint64_t));
+    return;
+  }
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+    H.add(ExprTag);
+    H.add(CE->getOpcode());
+    addType(H, CE->getType());
+    if (CE->isCompare())
+      H.add(CE->getPredicate());
+    for (unsigned i = 0, e = CE->getNumOperands(); i != e; ++i)
+      addValue(H, CE->getOperand(i));
+    return;
+  }
+  if (const Constant *C = dyn_cast<Constant>(V)) {
+    // Null, undef, zeroinitializer and aggregates.
+    H.add(C->getNumOperands() ? AggregateTag : SimpleConstantTag);
+    H.add(C->getValueID());
+    addType(H, C->getType());
+    for (unsigned i = 0, e = C->getNumOperands(); i != e; ++i)
+      addValue(H, C->getOperand(i));
+    return;
+  }
+  if (const MDString *S = dyn_cast<MDString>(V)) {
+    H.add(MDStringTag);
+    H.add(S->getString());
+    return;
+  }
+  if (const MDNode *N = dyn_cast<MDNode>(V)) {
+    // Debug info nodes can be cyclic; their shape is enough here.
+    H.add(MDNodeTag);
+    H.add(N->getNumOperands());
+    return;
+  }
+  if (const InlineAsm *IA = dyn_cast<InlineAsm>(V)) {
+    H.add(AsmTag);
+    H.add(IA->getAsmString());
+    H.add(IA->getConstraintString());
+    return;
+  }
+
+  // Anything else is unexpected; fall back to the kind of value.
+  H.add(V->getValueID());
+}
+
+uint64_t FunctionHasher::hash(const Function &F) {
+  FNVHash H;
+  H.add(F.getName());
+  addType(H, F.getType());
+
+  // Number everything local first so forward references are stable.
+  Numbers.clear();
+  HashedGlobals.clear();
+  unsigned N = 0;
+  for (Function::const_arg_iterator a = F.arg_begin(), ae = F.arg_end();
+       a != ae; ++a)
+    Numbers[a] = N++;
+  for (Function::const_iterator b = F.begin(), be = F.end(); b != be; ++b) {
+    Numbers[b] = N++;
+    for (BasicBlock::const_iterator i = b->begin(), ie = b->end(); i != ie; ++i)
+      Numbers[i] = N++;
+  }
+
+  for (Function::const_iterator b = F.begin(), be = F.end(); b != be; ++b) {
+    H.add(b->size());
+    for (BasicBlock::const_iterator i = b->begin(), ie = b->end();
+         i != ie; ++i) {
+      const Instruction *I = i;
+      H.add(I->getOpcode());
+      addType(H, I->getType());
+
+      if (const CmpInst *CI = dyn_cast<CmpInst>(I))
+        H.add(CI->getPredicate());
+      else if (const LoadInst *LI = dyn_cast<LoadInst>(I))
+        H.add(LI->isVolatile());
+      else if (const StoreInst *SI = dyn_cast<StoreInst>(I))
+        H.add(SI->isVolatile());
+      else if (const AllocaInst *AI = dyn_cast<AllocaInst>(I))
+        addType(H, AI->getAllocatedType());
+      else if (const ExtractValueInst *EVI = dyn_cast<ExtractValueInst>(I))
+        H.add(EVI->idx_begin(), (EVI->idx_end() - EVI->idx_begin()) *
+                                sizeof(unsigned));
+      else if (const InsertValueInst *IVI = dyn_cast<InsertValueInst>(I))
+        H.add(IVI->idx_begin(), (IVI->idx_end() - IVI->idx_begin()) *
+                                sizeof(unsigned));
+
+      H.add(I->getNumOperands());
+      for (unsigned o = 0, oe = I->getNumOperands(); o != oe; ++o)
+        addValue(H, I->getOperand(o));
+
+      // The source location, as the checkers see it and as printed.
+      const DebugLoc &DL = I->getDebugLoc();
+      SourceLoc Loc;
+      if (Locations.lookup(I, Loc)) {
+        H.add(Locations.getPath(Loc.File));
+        H.add(Loc.Line);
+        H.add(DL.getLine());
+        H.add(DL.getCol());
+      } else {
+        H.add(NoLocTag);
+        H.add(DL.getLine());
+      }
+    }
+  }
+  return H.get();
+}
+
+uint64_t FunctionHasher::hashDeclarations(const Module &M) {
+  FNVHash H;
+  H.add(M.size());
+  for (Module::const_iterator f = M.begin(), fe = M.end(); f != fe; ++f) {
+    H.add(f->getName());
+    addType(H, f->getType());
+  }
+
+  // A named type prints as its name, so hash one level of its body too.  The
+  // table is sorted by name.
+  const TypeSymbolTable &ST = M.getTypeSymbolTable();
+  H.add(ST.size());
+  for (TypeSymbolTable::const_iterator t = ST.begin(), te = ST.end();
+       t != te; ++t) {
+    const Type *T = t->second;
+    H.add(StringRef(t->first));
+    H.add(T->getTypeID());
+    H.add(T->getNumContainedTypes());
+    for (Type::subtype_iterator s = T->subtype_begin(), se = T->subtype_end();
+         s != se; ++s)
+      addType(H, *s);
+  }
+  return H.get();
+}
@@ -0,0 +1,60 @@
+//===-GlobalUseIndex.cpp---------------------------------------------------===//
+//
+// This file implements the module-wide index of global variable uses.
+//
+//===----------------------------------------------------------------------===//
+
+#include "GlobalUseIndex.h"
+#include "llvm/Constants.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+
+using namespace llvm;
+
+/// isAddressOf - Whether U only computes an address from its operand, so
+/// its users are counted as users of the global.
+static bool isAddressOf(const User *U) {
+  return isa<ConstantExpr>(U) || isa<GetElementPtrInst>(U) ||
+         isa<CastInst>(U);
+}
+
+void GlobalUseIndex::build(Module &M) {
+  clear();
+  Built = true;
+  for (Module::global_iterator g = M.global_begin(), ge = M.global_end();
+       g != ge; ++g) {
+    UseList *GlobalUses = 0;
+    for (Value::use_iterator u = g->use_begin(), ue = g->use_end(); u != ue;
+         ++u) {
+      User *U = *u;
+      if (!isAddressOf(U)) {
+        if (Instruction *I = dyn_cast<Instruction>(U)) {
+          if (!GlobalUses)
+            GlobalUses = &Uses[g];
+          GlobalUses->push_back(I);
+        }
+        continue;
+      }
+
+      for (Value::use_iterator uu = U->use_begin(), uue = U->use_end();
+           uu != uue; ++uu)
+        if (Instruction *I = dyn_cast<Instruction>(*uu)) {
+          if (!GlobalUses)
+            GlobalUses = &Uses[g];
+          GlobalUses->push_back(I);
+        }
+    }
+  }
+}
+
+void GlobalUseIndex::clear() {
+  Uses.clear();
+  Built = false;
+}
+
+const GlobalUseIndex::UseList &
+GlobalUseIndex::getUses(const GlobalVariable *G) const {
+  DenseMap<const GlobalVariable*, UseList>::const_iterator I = Uses.find(G);
+  return I == Uses.end() ? NoUses : I->second;
+}
@@ -0,0 +1,96 @@
+//===-LocationCache.cpp----------------------------------------------------===//
+//
+// This file implements the interned debug location cache used by PerfEvo.
+//
+//===----------------------------------------------------------------------===//
+
+#include "LocationCache.h"
+#include "llvm/Analysis/DebugInfo.h"
+#include "llvm/Instruction.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
+#include "llvm/Support/DebugLoc.h"
+
+#include <stdlib.h>
+
+using namespace llvm;
+
+unsigned LocationCache::getFileForScope(const MDNode *Scope) {
+  DenseMap<const MDNode*, unsigned>::iterator I = ScopeFiles.find(Scope);
+  if (I != ScopeFiles.end())
+    return I->second;
+
+  DIScope S(Scope);
+  std::string Name = S.getDirectory().str() + "/" + S.getFilename().str();
+
+  StringMap<unsigned>::iterator FI = FileIDs.find(Name);
+  unsigned File;
+  if (FI != FileIDs.end()) {
+    File = FI->second;
+  } else {
+    File = Paths.size();
+    FileIDs[Name] = File;
+    Paths.push_back(std::string());
+    if (char *Real = canonicalize_file_name(Name.c_str())) {
+      Paths.back() = Real;
+      free(Real);
+    }
+  }
+
+  ScopeFiles[Scope] = File;
+  return File;
+}
+
+SourceLoc LocationCache::resolveInlinedAt(const MDNode *IA) {
+  DenseMap<const MDNode*, SourceLoc>::iterator I = InlinedLocs.find(IA);
+  if (I != InlinedLocs.end())
+    return I->second;
+
+  DILocation L(IA);
+  while (L.getOrigLocation().Verify())
+    L = L.getOrigLocation();
+
+  SourceLoc Loc;
+  if (L.Verify() && L.getScope().Verify())
+    Loc = SourceLoc(getFileForScope(L.getScope()), L.getLineNumber());
+
+  InlinedLocs[IA] = Loc;
+  return Loc;
+}
+
+bool LocationCache::lookup(const Instruction *I, SourceLoc &Loc) {
+  const DebugLoc &DL = I->getDebugLoc();
+  if (DL.isUnknown())
+    return false;
+
+  const LLVMContext &Ctx = I->getContext();
+  MDNode *IA = DL.getInlinedAt(Ctx);
+  MDNode *Scope = IA ? 0 : DL.getScope(Ctx);
+  if (!IA && !Scope)
+    return false;
+
+  // Nearly every lookup hits the tables, so try that under the read lock.
+  {
+    sys::ScopedReader Guard(Lock);
+    if (IA) {
+      DenseMap<const MDNode*, SourceLoc>::iterator It = InlinedLocs.find(IA);
+      if (It != InlinedLocs.end()) {
+        Loc = It->second;
+        return isFound(Loc);
+      }
+    } else {
+      DenseMap<const MDNode*, unsigned>::iterator It = ScopeFiles.find(Scope);
+      if (It != ScopeFiles.end()) {
+        Loc = SourceLoc(It->second, DL.getLine());
+        return isFound(Loc);
+      }
+    }
+  }
+
+  sys::ScopedWriter Guard(Lock);
+  if (IA)
+    Loc = resolveInlinedAt(IA);
+  else
+    Loc = SourceLoc(getFileForScope(Scope), DL.getLine());
+  return isFound(Loc);
+}
@@ -0,0 +1,124 @@
+//===-ParallelRunner.cpp---------------------------------------------------===//
+//
+// This file implements the work-stealing function checker pool.
+//
+//===----------------------------------------------------------------------===//
+
+#include "ParallelRunner.h"
+#include "perfevo.h"
+#include "llvm/Function.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/System/DataTypes.h"
+#include "llvm/System/Mutex.h"
+
+#include <deque>
+#include <string>
+
+#include <pthread.h>
+
+using namespace llvm;
+
+namespace {
+/// WorkQueue - One worker's share of the functions, as indices into the
+/// module's function list.  The owner takes from the front; idle workers
+/// steal from the back.
+struct WorkQueue {
+  sys::Mutex Lock;
+  std::deque<unsigned> Items;
+};
+
+struct Worker {
+  PerfEvo *Pass;
+  const std::vector<const CheckerInfo*> *Selected;
+  const std::vector<Function*> *Functions;
+  std::vector<WorkQueue*> *Queues;
+  // Output of every function, indexed like Functions.  Each slot is only
+  // written by the worker that checked the function.
+  std::vector<std::string> *Outputs;
+  unsigned ID;
+};
+}
+
+/// takeWork - Pop the next function for worker Self, stealing from the other
+/// queues once its own is empty.  Nothing is ever added to a queue, so once
+/// every queue is empty all work has been handed out.
+static bool takeWork(std::vector<WorkQueue*> &Queues, unsigned Self,
+                     unsigned &Item) {
+  {
+    WorkQueue &Q = *Queues[Self];
+    sys::SmartScopedLock<false> Guard(Q.Lock);
+    if (!Q.Items.empty()) {
+      Item = Q.Items.front();
+      Q.Items.pop_front();
+      return true;
+    }
+  }
+
+  for (unsigned i = 1, e = Queues.size(); i != e; ++i) {
+    WorkQueue &Q = *Queues[(Self + i) % e];
+    sys::SmartScopedLock<false> Guard(Q.Lock);
+    if (!Q.Items.empty()) {
+      Item = Q.Items.back();
+      Q.Items.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
+static void *runWorker(void *Arg) {
+  Worker &W = *static_cast<Worker*>(Arg);
+
+  // Checkers keep per-function state, so each worker has its own.
+  CheckerSet Checkers;
+  for (unsigned i = 0, e = W.Selected->size(); i != e; ++i)
+    Checkers.add((*W.Selected)[i]);
+
+  unsigned Item;
+  while (takeWork(*W.Queues, W.ID, Item))
+    W.Pass->checkFunction(Checkers, *(*W.Functions)[Item], 0, 0,
+                          (*W.Outputs)[Item]);
+  return 0;
+}
+
+void runCheckersInParallel(PerfEvo &Pass,
+                           const std::vector<Function*> &Functions,
+                           const std::vector<const CheckerInfo*> &Selected,
+                           unsigned NumThreads,
+                           std::vector<std::string> &Outputs) {
+  Outputs.assign(Functions.size(), std::string());
+  if (NumThreads > Functions.size())
+    NumThreads = Functions.size();
+  if (NumThreads == 0)
+    return;
+
+  // Hand out contiguous runs of functions so neighbours, which tend to share
+  // source files, are checked by the same worker.
+  std::vector<WorkQueue*> Queues(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Queues[i] = new WorkQueue();
+    unsigned Begin = (uint64_t)Functions.size() * i / NumThreads;
+    unsigned End = (uint64_t)Functions.size() * (i + 1) / NumThreads;
+    for (unsigned j = Begin; j != End; ++j)
+      Queues[i]->Items.push_back(j);
+  }
+
+  std::vector<Worker> Workers(NumThreads);
+  std::vector<pthread_t> Threads(NumThreads);
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    Worker &W = Workers[i];
+    W.Pass = &Pass;
+    W.Selected = &Selected;
+    W.Functions = &Functions;
+    W.Queues = &Queues;
+    W.Outputs = &Outputs;
+    W.ID = i;
+    if (pthread_create(&Threads[i], 0, runWorker, &W) != 0)
+      report_fatal_error("PerfEvo: cannot create worker thread");
+  }
+
+  for (unsigned i = 0; i != NumThreads; ++i) {
+    pthread_join(Threads[i], 0);
+    delete Queues[i];
+  }
+}
@@ -0,0 +1,196 @@
+//===-PerfStats.cpp--------------------------------------------------------===//
+//
+// This file implements the timers and counters behind -perfStats.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PerfStats.h"
+#include "Finding.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <time.h>
+
+using namespace llvm;
+
+static cl::opt<bool> PrintStats("perfStats",
+       cl::desc("Print PerfEvo timers and counters on exit"));
+
+static cl::opt<std::string> StatsFilename("perfStatsFile",
+       cl::desc("Write PerfEvo timers and counters to this file as JSON"),
+       cl::value_desc("filename"));
+
+static cl::opt<unsigned> NumSlowest("perfStatsSlowest",
+       cl::desc("Number of slowest functions to list per checker"),
+       cl::init(5), cl::value_desc("N"));
+
+static ManagedStatic<PerfStats> Stats;
+
+static double getSeconds(clockid_t Clock) {
+  struct timespec TS;
+  if (clock_gettime(Clock, &TS) != 0)
+    return 0;
+  return TS.tv_sec + TS.tv_nsec / 1e9;
+}
+
+void StatsTimer::reset() {
+  Wall = getSeconds(CLOCK_MONOTONIC);
+  CPU = getSeconds(CLOCK_THREAD_CPUTIME_ID);
+}
+
+void StatsTimer::getElapsed(double &W, double &C) const {
+  W = getSeconds(CLOCK_MONOTONIC) - Wall;
+  C = getSeconds(CLOCK_THREAD_CPUTIME_ID) - CPU;
+}
+
+PerfStats::PerfStats()
+  : InstsWalked(0), SourceFiles(0), SourceLinesLoaded(0),
+    SourceLinesRead(0) {}
+
+PerfStats *PerfStats::get() {
+  if (!PrintStats && StatsFilename.empty())
+    return 0;
+  return &*Stats;
+}
+
+void PerfStats::addPhase(StringRef Name, double Wall, double CPU) {
+  sys::SmartScopedLock<false> Guard(Lock);
+  if (Phases.find(Name) == Phases.end())
+    PhaseOrder.push_back(Name.str());
+  PhaseStats &P = Phases[Name];
+  P.Wall += Wall;
+  P.CPU += CPU;
+  ++P.Runs;
+}
+
+void PerfStats::addFunction(StringRef Checker, StringRef Function,
+                            const CheckerCounters &C) {
+  sys::SmartScopedLock<false> Guard(Lock);
+  if (Checkers.find(Checker) == Checkers.end())
+    CheckerOrder.push_back(Checker.str());
+
+  CheckerStats &S = Checkers[Checker];
+  S.Total.Wall += C.Wall;
+  S.Total.CPU += C.CPU;
+  S.Total.Visited += C.Visited;
+  S.Total.CallsMatched += C.CallsMatched;
+  S.Total.Findings += C.Findings;
+  ++S.Functions;
+
+  // Keep the list sorted, slowest first, and no longer than asked for.
+  std::vector<std::pair<double, std::string> > &L = S.Slowest;
+  if (L.size() == NumSlowest && (L.empty() || L.back().first >= C.Wall))
+    return;
+  unsigned Pos = L.size();
+  while (Pos && L[Pos - 1].first < C.Wall)
+    --Pos;
+  L.insert(L.begin() + Pos,
+           std::make_pair(C.Wall, Function.empty() ? std::string("<module>")
+                                                   : Function.str()));
+  if (L.size() > NumSlowest)
+    L.pop_back();
+}
+
+void PerfStats::addInstructionsWalked(uint64_t N) {
+  sys::SmartScopedLock<false> Guard(Lock);
+  InstsWalked += N;
+}
+
+void PerfStats::addSourceFile(unsigned Lines) {
+  sys::SmartScopedLock<false> Guard(Lock);
+  ++SourceFiles;
+  SourceLinesLoaded += Lines;
+}
+
+void PerfStats::print(raw_ostream &OS) {
+  OS << "===" << std::string(73, '-') << "===\n"
+     << "                          PerfEvo statistics\n"
+     << "===" << std::string(73, '-') << "===\n\n";
+
+  OS << "   Wall(s)     CPU(s)      Runs  Phase\n";
+  for (unsigned i = 0, e = PhaseOrder.size(); i != e; ++i) {
+    const PhaseStats &P = Phases[PhaseOrder[i]];
+    OS << format("%10.4f", P.Wall) << format(" %10.4f", P.CPU)
+       << format(" %9llu", (unsigned long long)P.Runs)
+       << "  " << PhaseOrder[i] << '\n';
+  }
+
+  OS << "\n   Wall(s)     CPU(s) Functions     Insts     Calls  Findings"
+        "  Checker\n";
+  for (unsigned i = 0, e = CheckerOrder.size(); i != e; ++i) {
+    const CheckerStats &S = Checkers[CheckerOrder[i]];
+    OS << format("%10.4f", S.Total.Wall) << format(" %10.4f", S.Total.CPU)
+       << format(" %9llu", (unsigned long long)S.Functions)
+       << format(" %9llu", (unsigned long long)S.Total.Visited)
+       << format(" %9llu", (unsigned long long)S.Total.CallsMatched)
+       << format(" %9llu", (unsigned long long)S.Total.Findings)
+       << "  " << CheckerOrder[i] << '\n';
+  }
+
+  OS << '\n' << InstsWalked << " instructions walked\n"
+     << SourceFiles << " source files loaded, " << SourceLinesLoaded
+     << " lines\n"
+     << SourceLinesRead << " source lines read\n";
+
+  for (unsigned i = 0, e = CheckerOrder.size(); i != e; ++i) {
+    const CheckerStats &S = Checkers[CheckerOrder[i]];
+    if (S.Slowest.empty())
+      continue;
+    OS << "\nSlowest functions for " << CheckerOrder[i] << ":\n";
+    for (unsigned j = 0, je = S.Slowest.size(); j != je; ++j)
+      OS << format("%10.4f", S.Slowest[j].first) << "  "
+         << S.Slowest[j].second << '\n';
+  }
+  OS << '\n';
+}
+
+void PerfStats::printJSON(raw_ostream &OS) {
+  OS << "{\"phases\":[";
+  for (unsigned i = 0, e = PhaseOrder.size(); i != e; ++i) {
+    const PhaseStats &P = Phases[PhaseOrder[i]];
+    OS << (i ? "," : "") << "{\"name\":";
+    writeJSONString(OS, PhaseOrder[i]);
+    OS << ",\"runs\":" << P.Runs << ",\"wall\":" << format("%.6f", P.Wall)
+       << ",\"cpu\":" << format("%.6f", P.CPU) << '}';
+  }
+
+  OS << "],\"checkers\":[";
+  for (unsigned i = 0, e = CheckerOrder.size(); i != e; ++i) {
+    const CheckerStats &S = Checkers[CheckerOrder[i]];
+    OS << (i ? "," : "") << "{\"id\":";
+    writeJSONString(OS, CheckerOrder[i]);
+    OS << ",\"functions\":" << S.Functions
+       << ",\"visited\":" << S.Total.Visited
+       << ",\"callsMatched\":" << S.Total.CallsMatched
+       << ",\"findings\":" << S.Total.Findings
+       << ",\"wall\":" << format("%.6f", S.Total.Wall)
+       << ",\"cpu\":" << format("%.6f", S.Total.CPU) << ",\"slowest\":[";
+    for (unsigned j = 0, je = S.Slowest.size(); j != je; ++j) {
+      OS << (j ? "," : "") << "{\"function\":";
+      writeJSONString(OS, S.Slowest[j].second);
+      OS << ",\"wall\":" << format("%.6f", S.Slowest[j].first) << '}';
+    }
+    OS << "]}";
+  }
+
+  OS << "],\"instructionsWalked\":" << InstsWalked
+     << ",\"sourceFiles\":" << SourceFiles
+     << ",\"sourceLinesLoaded\":" << SourceLinesLoaded
+     << ",\"sourceLinesRead\":" << SourceLinesRead << "}\n";
+}
+
+PerfStats::~PerfStats() {
+  if (PrintStats)
+    print(errs());
+
+  if (!StatsFilename.empty()) {
+    std::string ErrorInfo;
+    raw_fd_ostream Out(StatsFilename.c_str(), ErrorInfo);
+    if (ErrorInfo.empty())
+      printJSON(Out);
+    else
+      errs() << "PerfEvo: " << ErrorInfo << "\n";
+  }
+}
@@ -0,0 +1,131 @@
+//===-Profile.cpp----------------------------------------------------------===//
+//
+// This file implements the readers for the sample profiles used to weight
+// findings.
+//
+//===----------------------------------------------------------------------===//
+
+#include "Profile.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <stdlib.h>
+
+using namespace llvm;
+
+static StringRef getFileName(StringRef Path) {
+  size_t Slash = Path.rfind('/');
+  return Slash == StringRef::npos ? Path : Path.substr(Slash + 1);
+}
+
+void Profile::addLine(StringRef File, unsigned Line, uint64_t Count) {
+  std::string Suffix = ":" + utostr(Line);
+  Lines[File.str() + Suffix] += Count;
+  FileNameLines[getFileName(File).str() + Suffix] += Count;
+}
+
+/// parseGprof - Read the flat profile part of gprof output:
+///
+///    %   cumulative   self              self     total
+///   time   seconds   seconds    calls  ms/call  ms/call  name
+///   33.34      0.02     0.02     7208     0.00     0.00  open
+///
+/// The call columns are empty for functions that were never entered.
+bool Profile::parseGprof(StringRef Text) {
+  size_t Start = Text.find("Flat profile:");
+  if (Start == StringRef::npos)
+    return false;
+  Text = Text.substr(Start);
+  size_t Header = Text.find(" name");
+  if (Header == StringRef::npos)
+    return false;
+  Text = Text.substr(Text.find('\n', Header) + 1);
+
+  while (!Text.empty()) {
+    std::pair<StringRef, StringRef> Split = Text.split('\n');
+    StringRef Line = Split.first.trim();
+    Text = Split.second;
+    // The flat profile ends at the first blank line.
+    if (Line.empty())
+      break;
+
+    SmallVector<StringRef, 8> Fields;
+    for (std::pair<StringRef, StringRef> F = getToken(Line); !F.first.empty();
+         F = getToken(F.second))
+      Fields.push_back(F.first);
+    if (Fields.size() < 4)
+      continue;
+
+    std::string Self = Fields[2].str();
+    char *End;
+    double Seconds = strtod(Self.c_str(), &End);
+    if (*End)
+      continue;
+    // Everything after the numeric columns is the name.  Names are looked
+    // up as mangled, so only "gprof --no-demangle" output matches C++
+    // functions; a demangled name with blanks is kept whole but matches
+    // nothing.
+    unsigned First = 3;
+    while (First != Fields.size() - 1 && Fields[First].find_first_not_of(
+             "0123456789.") == StringRef::npos)
+      ++First;
+    StringRef Name(Fields[First].data(),
+                   Fields.back().end() - Fields[First].data());
+    Functions[Name] += (uint64_t)(Seconds * 100 + 0.5);
+  }
+  return true;
+}
+
+bool Profile::load(StringRef Filename, std::string &ErrMsg) {
+  OwningPtr<MemoryBuffer> Buffer(MemoryBuffer::getFile(Filename, &ErrMsg));
+  if (!Buffer) {
+    ErrMsg = Filename.str() + ": " + ErrMsg;
+    return false;
+  }
+  StringRef Text = Buffer->getBuffer();
+  if (parseGprof(Text))
+    return Loaded = true;
+
+  for (unsigned LineNo = 1; !Text.empty(); ++LineNo) {
+    std::pair<StringRef, StringRef> Split = Text.split('\n');
+    StringRef Line = Split.first.trim();
+    Text = Split.second;
+    if (Line.empty() || Line[0] == '#')
+      continue;
+
+    std::pair<StringRef, StringRef> Field = getToken(Line);
+    unsigned long long Count;
+    StringRef Key = Field.second.trim();
+    if (Field.first.getAsInteger(10, Count) || Key.empty()) {
+      ErrMsg = Filename.str() + ":" + utostr(LineNo) +
+               ": expected '<count> <function>' or '<count> <file>:<line>'";
+      return false;
+    }
+
+    // A trailing ":<digits>" makes it a source line.
+    size_t Colon = Key.rfind(':');
+    unsigned SourceLine;
+    if (Colon != StringRef::npos && Colon != 0 &&
+        !Key.substr(Colon + 1).getAsInteger(10, SourceLine))
+      addLine(Key.substr(0, Colon), SourceLine, Count);
+    else
+      Functions[Key] += Count;
+  }
+  return Loaded = true;
+}
+
+uint64_t Profile::getFunctionSamples(StringRef Name) const {
+  StringMap<uint64_t>::const_iterator I = Functions.find(Name);
+  return I == Functions.end() ? 0 : I->second;
+}
+
+uint64_t Profile::getLineSamples(StringRef File, unsigned Line) const {
+  std::string Suffix = ":" + utostr(Line);
+  StringMap<uint64_t>::const_iterator I = Lines.find(File.str() + Suffix);
+  if (I != Lines.end())
+    return I->second;
+  I = FileNameLines.find(getFileName(File).str() + Suffix);
+  return I == FileNameLines.end() ? 0 : I->second;
+}
@@ -0,0 +1,401 @@
+//===-RuleFile.cpp---------------------------------------------------------===//
+//
+// This file implements the parser for rule files and the checker that runs
+// their rules.
+//
+//===----------------------------------------------------------------------===//
+
+#include "RuleFile.h"
+#include "CallSiteIndex.h"
+#include "PerfEvoChecker.h"
+#include "perfevo.h"
+#include "llvm/Constants.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/System/DataTypes.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+namespace {
+/// Condition - One condition of a rule on the call or one of its arguments.
+struct Condition {
+  enum ConditionKind {
+    ArgCount,
+    ArgEquals,
+    ArgNotEquals,
+    ArgConstant,
+    ArgString,
+    ArgType,
+    ArgFrom,
+    ResultUsed,
+    ResultUnused
+  };
+
+  ConditionKind Kind;
+  /// Arg - The argument index, or the argument count for ArgCount.
+  unsigned Arg;
+  int64_t Value;
+  /// Text - The glob or type name.
+  std::string Text;
+};
+
+/// RuleInfo - The registry entry of a rule.  The rule's checkers read their
+/// conditions from it.
+struct RuleInfo : public CheckerInfo {
+  std::string Name;
+  std::string Callee;
+  std::string Trigger;
+  const char *TriggerList[2];
+  /// Text - The lines of the rule, hashed into cache keys.
+  std::string Text;
+  std::vector<Condition> Conditions;
+  unsigned MinDepth, MaxDepth;
+  std::string Message;
+
+  RuleInfo() : MinDepth(0), MaxDepth(~0U) {}
+};
+
+class RuleChecker : public PerfEvoChecker {
+  const RuleInfo &Rule;
+  // Whether each callee seen so far matches the rule's callee glob.
+  DenseMap<const Function*, bool> Matched;
+  // The types named by the rule's conditions in the current module, by
+  // condition.
+  std::vector<const Type*> Types;
+
+  bool holds(unsigned i, CallSite CS) const;
+public:
+  explicit RuleChecker(const RuleInfo &R)
+    : Rule(R), Types(R.Conditions.size()) {}
+  void beginFunction(CheckerContext &C);
+  void visit(Instruction *I, CheckerContext &C);
+};
+}
+
+static PerfEvoChecker *createRuleChecker(const CheckerInfo &Info) {
+  return new RuleChecker(static_cast<const RuleInfo&>(Info));
+}
+
+bool matchGlob(StringRef Pattern, StringRef Name) {
+  // On a mismatch, let the last '*' seen swallow one more character.
+  size_t P = 0, N = 0, Star = StringRef::npos, Resume = 0;
+  while (N != Name.size()) {
+    if (P != Pattern.size() && (Pattern[P] == '?' || Pattern[P] == Name[N])) {
+      ++P;
+      ++N;
+    } else if (P != Pattern.size() && Pattern[P] == '*') {
+      Star = P++;
+      Resume = N;
+    } else if (Star != StringRef::npos) {
+      P = Star + 1;
+      N = ++Resume;
+    } else {
+      return false;
+    }
+  }
+  while (P != Pattern.size() && Pattern[P] == '*')
+    ++P;
+  return P == Pattern.size();
+}
+
+/// getLiteral - Return the longest run of Glob without wildcards.
+static StringRef getLiteral(StringRef Glob) {
+  StringRef Longest;
+  for (;;) {
+    size_t Wild = Glob.find_first_of("*?");
+    StringRef Run = Glob.substr(0, Wild);
+    if (Run.size() > Longest.size())
+      Longest = Run;
+    if (Wild == StringRef::npos)
+      return Longest;
+    Glob = Glob.substr(Wild + 1);
+  }
+}
+
+/// getCString - If V points to a constant C string, set S to it without the
+/// terminating null.
+static bool getCString(Value *V, std::string &S) {
+  GlobalVariable *GV = dyn_cast<GlobalVariable>(V->stripPointerCasts());
+  if (!GV || !GV->isConstant() || !GV->hasDefinitiveInitializer())
+    return false;
+  ConstantArray *CA = dyn_cast<ConstantArray>(GV->getInitializer());
+  if (!CA || !CA->isCString())
+    return false;
+  S = CA->getAsString();
+  S.resize(S.size() - 1);
+  return true;
+}
+
+void RuleChecker::beginFunction(CheckerContext &C) {
+  for (unsigned i = 0, e = Rule.Conditions.size(); i != e; ++i)
+    if (Rule.Conditions[i].Kind == Condition::ArgType)
+      Types[i] = C.Pass.getTypes().lookup(Rule.Conditions[i].Text);
+}
+
+bool RuleChecker::holds(unsigned i, CallSite CS) const {
+  const Condition &Cond = Rule.Conditions[i];
+  switch (Cond.Kind) {
+  case Condition::ArgCount:
+    return CS.arg_size() == Cond.Arg;
+  case Condition::ResultUsed:
+    return !CS.getInstruction()->use_empty();
+  case Condition::ResultUnused:
+    return CS.getInstruction()->use_empty();
+  default:
+    break;
+  }
+
+  if (Cond.Arg >= CS.arg_size())
+    return false;
+  Value *V = CS.getArgument(Cond.Arg);
+  switch (Cond.Kind) {
+  case Condition::ArgEquals:
+  case Condition::ArgNotEquals: {
+    ConstantInt *CI = dyn_cast<ConstantInt>(V);
+    bool Equal = CI && CI->getBitWidth() <= 64 &&
+                 (CI->getSExtValue() == Cond.Value ||
+                  CI->getZExtValue() == (uint64_t)Cond.Value);
+    return Equal == (Cond.Kind == Condition::ArgEquals);
+  }
+  case Condition::ArgConstant:
+    return isa<Constant>(V);
+  case Condition::ArgString: {
+    std::string S;
+    return getCString(V, S) && matchGlob(Cond.Text, S);
+  }
+  case Condition::ArgType:
+    return Types[i] && V->getType() == Types[i];
+  case Condition::ArgFrom: {
+    Instruction *Def = dyn_cast<Instruction>(V->stripPointerCasts());
+    if (!Def || (!isa<CallInst>(Def) && !isa<InvokeInst>(Def)))
+      return false;
+    const Function *F = CallSiteIndex::getCallee(Def);
+    return F && matchGlob(Cond.Text, F->getName());
+  }
+  default:
+    return false;
+  }
+}
+
+void RuleChecker::visit(Instruction *I, CheckerContext &C) {
+  CallSite CS(I);
+  const Function *Callee = CallSiteIndex::getCallee(I);
+  if (!CS.getInstruction() || !Callee)
+    return;
+
+  DenseMap<const Function*, bool>::iterator M = Matched.find(Callee);
+  if (M == Matched.end())
+    M = Matched.insert(std::make_pair(Callee,
+                         matchGlob(Rule.Callee, Callee->getName()))).first;
+  if (!M->second)
+    return;
+
+  for (unsigned i = 0, e = Rule.Conditions.size(); i != e; ++i)
+    if (!holds(i, CS))
+      return;
+
+  unsigned Depth = C.LI ? C.LI->getLoopDepth(I->getParent()) : 0;
+  if (Depth < Rule.MinDepth || Depth > Rule.MaxDepth)
+    return;
+  C.report(I, Depth, Rule.Message);
+}
+
+/// finishRule - Check that R is complete and fill in its registry entry.
+static bool finishRule(RuleInfo &R, std::string &Msg) {
+  if (R.Callee.empty()) {
+    Msg = "rule " + R.Name + " has no callee";
+    return false;
+  }
+  R.Trigger = getLiteral(R.Callee);
+  if (R.Trigger.empty()) {
+    Msg = "callee of rule " + R.Name + " has no characters besides wildcards";
+    return false;
+  }
+  R.TriggerList[0] = R.Trigger.c_str();
+  R.TriggerList[1] = 0;
+
+  R.ID = R.Name.c_str();
+  R.Scope = FunctionScope;
+  R.Analyses = R.MinDepth || R.MaxDepth != ~0U ? NeedsLoopInfo : NoAnalyses;
+  R.Triggers = R.TriggerList;
+  R.Source = R.Text.c_str();
+  R.Create = &createRuleChecker;
+  return true;
+}
+
+/// parseCondition - Add the condition on the rest of Line, after Keyword,
+/// to R.
+static bool parseCondition(RuleInfo &R, StringRef Keyword, StringRef Line,
+                           std::string &Msg) {
+  if (Keyword == "callee") {
+    R.Callee = Line;
+    if (R.Callee.empty())
+      Msg = "expected 'callee <glob>'";
+    return !R.Callee.empty();
+  }
+  if (Keyword == "message") {
+    R.Message = Line;
+    return true;
+  }
+
+  Condition Cond;
+  Cond.Arg = 0;
+  Cond.Value = 0;
+  std::pair<StringRef, StringRef> Field = getToken(Line);
+  if (Keyword == "args") {
+    Cond.Kind = Condition::ArgCount;
+    if (Field.first.getAsInteger(10, Cond.Arg) || !Field.second.empty()) {
+      Msg = "expected 'args <n>'";
+      return false;
+    }
+    R.Conditions.push_back(Cond);
+    return true;
+  }
+  if (Keyword == "result") {
+    if (Field.first == "used") {
+      Cond.Kind = Condition::ResultUsed;
+    } else if (Field.first == "unused") {
+      Cond.Kind = Condition::ResultUnused;
+    } else {
+      Msg = "expected 'result used' or 'result unused'";
+      return false;
+    }
+    R.Conditions.push_back(Cond);
+    return true;
+  }
+  if (Keyword == "loop") {
+    unsigned Depth;
+    if (getToken(Field.second).first.getAsInteger(10, Depth) ||
+        !getToken(Field.second).second.empty()) {
+      Msg = "expected 'loop >=|==|<= <n>'";
+      return false;
+    }
+    if (Field.first == ">=") {
+      R.MinDepth = std::max(R.MinDepth, Depth);
+    } else if (Field.first == "<=") {
+      R.MaxDepth = std::min(R.MaxDepth, Depth);
+    } else if (Field.first == "==") {
+      R.MinDepth = std::max(R.MinDepth, Depth);
+      R.MaxDepth = std::min(R.MaxDepth, Depth);
+    } else {
+      Msg = "expected 'loop >=|==|<= <n>'";
+      return false;
+    }
+    return true;
+  }
+  if (Keyword != "arg") {
+    Msg = "unknown condition '" + Keyword.str() + "'";
+    return false;
+  }
+
+  if (Field.first.getAsInteger(10, Cond.Arg)) {
+    Msg = "expected 'arg <i> ...'";
+    return false;
+  }
+  std::pair<StringRef, StringRef> Op = getToken(Field.second);
+  StringRef Rest = Op.second.trim();
+  if (Op.first == "==" || Op.first == "!=") {
+    Cond.Kind = Op.first == "==" ? Condition::ArgEquals
+                                 : Condition::ArgNotEquals;
+    long long Value;
+    if (Rest.getAsInteger(0, Value)) {
+      Msg = "expected an integer after '" + Op.first.str() + "'";
+      return false;
+    }
+    Cond.Value = Value;
+  } else if (Op.first == "const") {
+    Cond.Kind = Condition::ArgConstant;
+  } else if (Op.first == "string" || Op.first == "type" ||
+             Op.first == "from") {
+    Cond.Kind = Op.first == "string" ? Condition::ArgString :
+                Op.first == "type" ? Condition::ArgType : Condition::ArgFrom;
+    Cond.Text = Rest;
+    if (Cond.Text.empty()) {
+      Msg = "expected text after '" + Op.first.str() + "'";
+      return false;
+    }
+  } else {
+    Msg = "expected '==', '!=', 'const', 'string', 'type' or 'from' after "
+          "'arg <i>'";
+    return false;
+  }
+  R.Conditions.push_back(Cond);
+  return true;
+}
+
+static bool parseRules(StringRef Filename, StringRef Text,
+                       std::vector<RuleInfo*> &Rules, std::string &ErrMsg) {
+  std::string Msg;
+  unsigned LineNo = 0;
+  for (; !Text.empty(); ) {
+    std::pair<StringRef, StringRef> Split = Text.split('\n');
+    StringRef Line = Split.first.trim();
+    Text = Split.second;
+    ++LineNo;
+    if (Line.empty() || Line[0] == '#')
+      continue;
+
+    std::pair<StringRef, StringRef> Keyword = getToken(Line);
+    if (Keyword.first == "rule") {
+      if (!Rules.empty() && !finishRule(*Rules.back(), Msg))
+        break;
+      StringRef Name = Keyword.second.trim();
+      if (Name.empty() || Name.find_first_of(" \t,") != StringRef::npos) {
+        Msg = "expected 'rule <ID>'";
+        break;
+      }
+      bool Taken = CheckerRegistry::lookup(Name);
+      for (unsigned i = 0, e = Rules.size(); i != e; ++i)
+        Taken |= Rules[i]->Name == Name;
+      if (Taken) {
+        Msg = "a checker named " + Name.str() + " already exists";
+        break;
+      }
+      Rules.push_back(new RuleInfo());
+      Rules.back()->Name = Name;
+    } else if (Rules.empty()) {
+      Msg = "expected 'rule <ID>' before the first condition";
+      break;
+    } else if (!parseCondition(*Rules.back(), Keyword.first,
+                               Keyword.second.trim(), Msg)) {
+      break;
+    }
+    Rules.back()->Text += Line.str() + "\n";
+  }
+
+  if (Msg.empty() && !Rules.empty() && finishRule(*Rules.back(), Msg))
+    return true;
+  if (Msg.empty())
+    Msg = "no rules";
+  ErrMsg = Filename.str() + ":" + utostr(LineNo) + ": " + Msg;
+  return false;
+}
+
+bool loadRuleFile(StringRef Filename, std::string &ErrMsg) {
+  OwningPtr<MemoryBuffer> Buffer(MemoryBuffer::getFile(Filename, &ErrMsg));
+  if (!Buffer) {
+    ErrMsg = Filename.str() + ": " + ErrMsg;
+    return false;
+  }
+
+  std::vector<RuleInfo*> Rules;
+  if (!parseRules(Filename, Buffer->getBuffer(), Rules, ErrMsg)) {
+    for (unsigned i = 0, e = Rules.size(); i != e; ++i)
+      delete Rules[i];
+    return false;
+  }
+  // The registry refers to the rules until the program exits.
+  for (unsigned i = 0, e = Rules.size(); i != e; ++i)
+    CheckerRegistry::add(Rules[i]);
+  return true;
+}
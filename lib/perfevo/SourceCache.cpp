@@ -0,0 +1,217 @@
+//===-SourceCache.cpp------------------------------------------------------===//
+//
+// This file implements the lazily mapped source line cache used by PerfEvo.
+//
+//===----------------------------------------------------------------------===//
+
+#include "SourceCache.h"
+#include "PerfStats.h"
+
+#include <algorithm>
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+SourceCache::~SourceCache() {
+  for (StringMap<SourceFile*>::iterator I = Files.begin(), E = Files.end();
+       I != E; ++I) {
+    SourceFile *SF = I->second;
+    if (SF->Data)
+      munmap(const_cast<char *>(SF->Data), SF->Size);
+    delete SF->Tokens;
+    delete SF;
+  }
+}
+
+SourceCache::SourceFile *SourceCache::getFile(StringRef Path) {
+  {
+    sys::ScopedReader Guard(Lock);
+    StringMap<SourceFile*>::iterator I = Files.find(Path);
+    if (I != Files.end())
+      return I->second;
+  }
+
+  sys::ScopedWriter Guard(Lock);
+  SourceFile *&SF = Files[Path];
+  if (SF)
+    return SF;
+
+  // A file we fail to open is remembered as empty so we only try once.
+  SF = new SourceFile();
+  loadFile(Path, SF);
+  return SF;
+}
+
+void SourceCache::loadFile(StringRef Path, SourceFile *SF) {
+  int FD = open(Path.str().c_str(), O_RDONLY);
+  if (FD < 0)
+    return;
+
+  struct stat Stat;
+  if (fstat(FD, &Stat) != 0 || Stat.st_size == 0 ||
+      (uint64_t)Stat.st_size > UINT32_MAX) {
+    close(FD);
+    return;
+  }
+
+  void *Map = mmap(0, Stat.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+  close(FD);
+  if (Map == MAP_FAILED)
+    return;
+
+  SF->Data = static_cast<const char *>(Map);
+  SF->Size = Stat.st_size;
+
+  // Index line starts.  A trailing newline does not open another line.
+  const char *Cur = SF->Data, *End = SF->Data + SF->Size;
+  SF->LineStarts.push_back(0);
+  while (const char *NL = (const char *)memchr(Cur, '\n', End - Cur)) {
+    Cur = NL + 1;
+    if (Cur == End)
+      break;
+    SF->LineStarts.push_back(Cur - SF->Data);
+  }
+
+  if (PerfStats *Stats = PerfStats::get())
+    Stats->addSourceFile(SF->LineStarts.size());
+}
+
+StringRef SourceCache::getLine(StringRef Path, unsigned Line) {
+  if (Path.empty() || Line == 0)
+    return StringRef();
+
+  if (PerfStats *Stats = PerfStats::get())
+    Stats->addSourceLineRead();
+
+  return getLine(getFile(Path), Line);
+}
+
+StringRef SourceCache::getLine(const SourceFile *SF, unsigned Line) {
+  if (Line == 0 || Line > SF->LineStarts.size())
+    return StringRef();
+
+  const char *Begin = SF->Data + SF->LineStarts[Line - 1];
+  const char *End = Line < SF->LineStarts.size()
+                    ? SF->Data + SF->LineStarts[Line] - 1
+                    : SF->Data + SF->Size;
+  if (End > Begin && End[-1] == '\n')
+    --End;
+  return StringRef(Begin, End - Begin);
+}
+
+static bool isIdentifierChar(char C) {
+  return isalnum((unsigned char)C) || C == '_';
+}
+
+void SourceCache::indexTokens(SourceFile *SF) {
+  SF->Tokens = new LineIndex();
+  const char *Cur = SF->Data, *End = SF->Data + SF->Size;
+  unsigned Line = 1;
+  while (Cur != End) {
+    if (*Cur == '\n') {
+      ++Line;
+      ++Cur;
+      continue;
+    }
+    if (!isIdentifierChar(*Cur)) {
+      ++Cur;
+      continue;
+    }
+
+    const char *Start = Cur;
+    while (Cur != End && isIdentifierChar(*Cur))
+      ++Cur;
+    std::vector<unsigned> &Lines =
+      (*SF->Tokens)[StringRef(Start, Cur - Start)];
+    if (Lines.empty() || Lines.back() != Line)
+      Lines.push_back(Line);
+  }
+}
+
+/// search - Find the lines of SF containing Pattern.  A line can only
+/// contain Pattern if it has a token containing the longest identifier in
+/// Pattern, so only the lines of such tokens are searched.
+void SourceCache::search(SourceFile *SF, StringRef Pattern,
+                         std::vector<unsigned> &Lines) {
+  StringRef Key;
+  for (unsigned i = 0, e = Pattern.size(); i != e; ) {
+    if (!isIdentifierChar(Pattern[i])) {
+      ++i;
+      continue;
+    }
+    unsigned Start = i;
+    while (i != e && isIdentifierChar(Pattern[i]))
+      ++i;
+    if (i - Start > Key.size())
+      Key = Pattern.substr(Start, i - Start);
+  }
+
+  std::vector<unsigned> Candidates;
+  if (Key.empty()) {
+    // Nothing to look up, so every line is a candidate.
+    for (unsigned L = 1, e = SF->LineStarts.size(); L <= e; ++L)
+      Candidates.push_back(L);
+  } else {
+    if (!SF->Tokens)
+      indexTokens(SF);
+
+    // If Pattern has other characters on both sides of Key, Key is a whole
+    // token of every matching line.  Otherwise it may be part of a longer
+    // one.
+    if (Key.begin() != Pattern.begin() && Key.end() != Pattern.end()) {
+      LineIndex::iterator I = SF->Tokens->find(Key);
+      if (I != SF->Tokens->end())
+        Candidates = I->second;
+    } else {
+      for (LineIndex::iterator I = SF->Tokens->begin(),
+           E = SF->Tokens->end(); I != E; ++I)
+        if (I->getKey().find(Key) != StringRef::npos)
+          Candidates.insert(Candidates.end(),
+                            I->second.begin(), I->second.end());
+      std::sort(Candidates.begin(), Candidates.end());
+      Candidates.erase(std::unique(Candidates.begin(), Candidates.end()),
+                       Candidates.end());
+    }
+  }
+
+  for (unsigned i = 0, e = Candidates.size(); i != e; ++i)
+    if (getLine(SF, Candidates[i]).find(Pattern) != StringRef::npos)
+      Lines.push_back(Candidates[i]);
+}
+
+const std::vector<unsigned> &SourceCache::findLines(StringRef Path,
+                                                    StringRef Pattern) {
+  SourceFile *SF = getFile(Path);
+  {
+    sys::ScopedReader Guard(Lock);
+    LineIndex::iterator I = SF->Searches.find(Pattern);
+    if (I != SF->Searches.end())
+      return I->second;
+  }
+
+  sys::ScopedWriter Guard(Lock);
+  LineIndex::iterator I = SF->Searches.find(Pattern);
+  if (I != SF->Searches.end())
+    return I->second;
+
+  std::vector<unsigned> &Lines = SF->Searches[Pattern];
+  search(SF, Pattern, Lines);
+  return Lines;
+}
+
+bool SourceCache::lineContains(StringRef Path, unsigned Line,
+                               StringRef Pattern) {
+  if (Pattern.empty())
+    return true;
+  if (Path.empty() || Line == 0)
+    return false;
+
+  const std::vector<unsigned> &Lines = findLines(Path, Pattern);
+  return std::binary_search(Lines.begin(), Lines.end(), Line);
+}
@@ -0,0 +1,74 @@
+//===-TripCount.cpp--------------------------------------------------------===//
+//
+// This file implements the trip count estimates attached to findings in
+// loops.
+//
+//===----------------------------------------------------------------------===//
+
+#include "TripCount.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Assembly/Writer.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <vector>
+
+using namespace llvm;
+
+/// getTripCount - Return the trip count of L if it is a known constant, or
+/// zero after printing what is known about it to OS.
+static uint64_t getTripCount(const Loop *L, ScalarEvolution *SE,
+                             raw_ostream &OS) {
+  if (SE) {
+    const SCEV *BTC = SE->getBackedgeTakenCount(L);
+    if (isa<SCEVCouldNotCompute>(BTC)) {
+      OS << '?';
+      return 0;
+    }
+    if (const SCEVConstant *C = dyn_cast<SCEVConstant>(BTC)) {
+      uint64_t N = C->getValue()->getValue().getLimitedValue();
+      if (N != ~0ULL)
+        return N + 1;
+    }
+    OS << '(';
+    SE->getAddExpr(BTC, SE->getConstant(BTC->getType(), 1))->print(OS);
+    OS << ')';
+    return 0;
+  }
+
+  if (unsigned N = L->getSmallConstantTripCount())
+    return N;
+  if (Value *TC = L->getTripCount())
+    WriteAsOperand(OS, TC, false);
+  else
+    OS << '?';
+  return 0;
+}
+
+double estimateTripCount(const Loop *L, ScalarEvolution *SE,
+                         unsigned Unknown, std::string &Text) {
+  std::vector<const Loop*> Nest;
+  for (; L; L = L->getParentLoop())
+    Nest.push_back(L);
+
+  double Count = 1;
+  raw_string_ostream OS(Text);
+  for (unsigned i = Nest.size(); i != 0; --i) {
+    if (i != Nest.size())
+      OS << " x ";
+    if (uint64_t N = getTripCount(Nest[i - 1], SE, OS)) {
+      OS << N;
+      Count *= N;
+    } else {
+      Count *= Unknown;
+    }
+  }
+  OS.flush();
+  return Count;
+}
+
+uint64_t getConstantTripCount(const Loop *L, ScalarEvolution *SE) {
+  raw_null_ostream OS;
+  return getTripCount(L, SE, OS);
+}
@@ -13,23 +13,45 @@
 #define DEBUG_TYPE "perfevo"
 
 #include "perfevo.h"
+#include "BlockReachability.h"
+#include "CallGraphSummary.h"
+#include "CalleeMatcher.h"
+#include "Dataflow.h"
+#include "Finding.h"
+#include "FunctionHash.h"
+#include "GlobalUseIndex.h"
+#include "IRMatch.h"
+#include "ParallelRunner.h"
+#include "PerfStats.h"
+#include "RuleFile.h"
+#include "TripCount.h"
+#include "llvm/ADT/BitVector.h"
 #include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Analysis/DebugInfo.h"
+#include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Assembly/Writer.h"
 #include "llvm/Constants.h"
 #include "llvm/Function.h"
 #include "llvm/Instruction.h"
 #include "llvm/LLVMContext.h"
 #include "llvm/Module.h"
+#include "llvm/Operator.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CFG.h"
 #include "llvm/Support/CallSite.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/InstVisitor.h"
 #include "llvm/Support/FormattedStream.h"
 #include "llvm/Support/GetElementPtrTypeIterator.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/System/DataTypes.h"
+#include "llvm/System/Threading.h"
 #include "llvm/Target/TargetInstrInfo.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Transforms/Scalar.h"
@@ -52,247 +74,159 @@
 #include <vector>
 #include <set>
 using namespace llvm;
+using namespace IRMatch;
 
 
-////////////////////////////////////////
-class TypeFinder {
-  // To avoid walking constant expressions multiple times and other IR
-  // objects, we keep several helper maps.
-  DenseSet<const Value*> VisitedConstants;
-  DenseSet<const Type*> VisitedTypes;
-
-  TypePrinting &TP;
-  std::vector<const Type*> &NumberedTypes;
-public:
-  TypeFinder(TypePrinting &tp, std::vector<const Type*> &numberedTypes)
-    : TP(tp), NumberedTypes(numberedTypes) {}
-
-  void Run(const Module &M) {
-    // Get types from the type symbol table.  This gets opaque types referened
-    // only through derived named types.
-    const TypeSymbolTable &ST = M.getTypeSymbolTable();
-    for (TypeSymbolTable::const_iterator TI = ST.begin(), E = ST.end();
-         TI != E; ++TI)
-      IncorporateType(TI->second);
-
-    // Get types from global variables.
-    for (Module::const_global_iterator I = M.global_begin(),
-         E = M.global_end(); I != E; ++I) {
-      IncorporateType(I->getType());
-      if (I->hasInitializer())
-        IncorporateValue(I->getInitializer());
-    }
-
-    // Get types from aliases.
-    for (Module::const_alias_iterator I = M.alias_begin(),
-         E = M.alias_end(); I != E; ++I) {
-      IncorporateType(I->getType());
-      IncorporateValue(I->getAliasee());
-    }
-
-    // Get types from functions.
-    for (Module::const_iterator FI = M.begin(), E = M.end(); FI != E; ++FI) {
-      IncorporateType(FI->getType());
-
-      for (Function::const_iterator BB = FI->begin(), E = FI->end();
-           BB != E;++BB)
-        for (BasicBlock::const_iterator II = BB->begin(),
-             E = BB->end(); II != E; ++II) {
-          const Instruction &I = *II;
-          // Incorporate the type of the instruction and all its operands.
-          IncorporateType(I.getType());
-          for (User::const_op_iterator OI = I.op_begin(), OE = I.op_end();
-               OI != OE; ++OI)
-            IncorporateValue(*OI);
-        }
-     }
-  }
-
-private:
-  void IncorporateType(const Type *Ty) {
-    // Check to see if we're already visited this type.
-    if (!VisitedTypes.insert(Ty).second)
-      return;
-
-    // If this is a structure or opaque type, add a name for the type.
-    if (((Ty->isStructTy() && cast<StructType>(Ty)->getNumElements())
-          || Ty->isOpaqueTy()) && !TP.hasTypeName(Ty)) {
-      TP.addTypeName(Ty, "%"+utostr(unsigned(NumberedTypes.size())));
-      NumberedTypes.push_back(Ty);
-    }
-
-    // Recursively walk all contained types.
-    for (Type::subtype_iterator I = Ty->subtype_begin(),
-         E = Ty->subtype_end(); I != E; ++I)
-      IncorporateType(*I);
-  }
-
-    /// IncorporateValue - This method is used to walk operand lists finding
-    /// types hiding in constant expressions and other operands that won't be
-    /// walked in other ways.  GlobalValues, basic blocks, instructions, and
-    /// inst operands are all explicitly enumerated.
-  void IncorporateValue(const Value *V) {
-    if (V == 0 || !isa<Constant>(V) || isa<GlobalValue>(V)) return;
-
-    // Already visited?
-    if (!VisitedConstants.insert(V).second)
-      return;
-
-    // Check this type.
-    IncorporateType(V->getType());
-
-    // Look in operands for types.
-    const Constant *C = cast<Constant>(V);
-    for (Constant::const_op_iterator I = C->op_begin(),
-         E = C->op_end(); I != E;++I)
-      IncorporateValue(*I);
-  }
-};
-
+static cl::list<std::string> PerfBugIDs("perfBugID",
+       cl::desc("Performance bug IDs to check, comma separated, or 'all'"),
+       cl::OneOrMore, cl::CommaSeparated,
+       cl::value_desc("perfBugID"));
 
-// PrintEscapedString - Print each character of the specified string, escaping
-// it if it is not printable or if it is an escape char.
-static void PrintEscapedString(StringRef Name, raw_ostream &Out) {
-  for (unsigned i = 0, e = Name.size(); i != e; ++i) {
-    unsigned char C = Name[i];
-    if (isprint(C) && C != '\\' && C != '"')
-      Out << C;
-    else
-      Out << '\\' << hexdigit(C >> 4) << hexdigit(C & 0x0F);
-  }
+static cl::list<std::string> RuleFiles("perfRules",
+       cl::desc("Add the checkers defined in these rule files"),
+       cl::CommaSeparated, cl::value_desc("filename"));
+
+static cl::opt<unsigned> NumThreads("perfThreads",
+       cl::desc("Run function checkers on this many threads"),
+       cl::init(1), cl::value_desc("N"));
+
+static cl::opt<std::string> CacheFilename("perfCache",
+       cl::desc("Reuse checker output for unchanged functions from this file"),
+       cl::value_desc("filename"));
+
+static cl::opt<FindingFormat> Format("perfFormat",
+       cl::desc("Format of the findings"),
+       cl::values(clEnumValN(TextFormat, "text", "Readable text (default)"),
+                  clEnumValN(JSONLinesFormat, "jsonl", "One JSON object per line"),
+                  clEnumValN(SARIFFormat, "sarif", "SARIF 2.1.0 log"),
+                  clEnumValEnd),
+       cl::init(TextFormat));
+
+static cl::opt<std::string> OutputFilename("perfOutput",
+       cl::desc("Write the findings to this file instead of stderr"),
+       cl::value_desc("filename"));
+
+static cl::opt<bool> TripCounts("perfTripCounts",
+       cl::desc("Estimate how often findings in loops run and list findings "
+                "by that estimate"));
+
+static cl::opt<unsigned> UnknownTripCount("perfUnknownTripCount",
+       cl::desc("Trip count assumed for loops without a constant one"),
+       cl::init(100), cl::value_desc("N"));
+
+static cl::opt<unsigned> NumTop("perfTop",
+       cl::desc("With -perfTripCounts or -perfProfile, only list the N highest "
+                "ranked findings"),
+       cl::init(0), cl::value_desc("N"));
+
+static cl::opt<std::string> ProfileFilename("perfProfile",
+       cl::desc("Weigh findings by the sample counts in this file"),
+       cl::value_desc("filename"));
+
+static cl::opt<unsigned> ProfileThreshold("perfProfileThreshold",
+       cl::desc("With -perfProfile, drop findings with fewer samples"),
+       cl::init(0), cl::value_desc("N"));
+
+/// rankFindings - Whether findings are collected and listed by weight at the
+/// end of the module rather than written as they are found.
+static bool rankFindings() {
+  return TripCounts || !ProfileFilename.empty();
 }
 
-enum PrefixType {
-  GlobalPrefix,
-  LabelPrefix,
-  LocalPrefix,
-  NoPrefix
-};
-
-
-/// PrintLLVMName - Turn the specified name into an 'LLVM name', which is either
-/// prefixed with % (if the string only contains simple characters) or is
-/// surrounded with ""'s (if it has special chars in it).  Print it out.
-static void PrintLLVMName(raw_ostream &OS, StringRef Name, PrefixType Prefix) {
-  assert(Name.data() && "Cannot get empty name!");
-  switch (Prefix) {
-  default: llvm_unreachable("Bad prefix!");
-  case NoPrefix: break;
-  case GlobalPrefix: OS << '@'; break;
-  case LabelPrefix:  break;
-  case LocalPrefix:  OS << '%'; break;
-  }
-
-  // Scan the name to see if it needs quotes first.
-  bool NeedsQuotes = isdigit(Name[0]);
-  if (!NeedsQuotes) {
-    for (unsigned i = 0, e = Name.size(); i != e; ++i) {
-      char C = Name[i];
-      if (!isalnum(C) && C != '-' && C != '.' && C != '_') {
-        NeedsQuotes = true;
-        break;
-      }
-    }
-  }
-
-  // If we didn't need any quotes, just write out the name in one blast.
-  if (!NeedsQuotes) {
-    OS << Name;
-    return;
+PerfEvo::PerfEvo() : FunctionPass(ID), Err(errs()), _M(0),
+                     OwnedSources(new SourceCache()),
+                     Sources(OwnedSources.get()), Collector(0), Cache(0),
+                     Declarations(0), Samples(0), NumRanked(0) {
+  // Ranked findings are not written per function, so there is nothing to
+  // cache.
+  if (!CacheFilename.empty() && !rankFindings()) {
+    OwnedCache.reset(new AnalysisCache(CacheFilename));
+    Cache = OwnedCache.get();
   }
-
-  // Okay, we need quotes.  Output the quotes and escape any scary characters as
-  // needed.
-  OS << '"';
-  PrintEscapedString(Name, OS);
-  OS << '"';
 }
 
+PerfEvo::PerfEvo(SourceCache &Shared, ReportCollector &C,
+                 AnalysisCache *SharedCache)
+  : FunctionPass(ID), Err(errs()), _M(0), Sources(&Shared), Collector(&C),
+    Cache(rankFindings() ? 0 : SharedCache), Declarations(0), Samples(0),
+    NumRanked(0) {}
 
-/// AddModuleTypesToPrinter - Add all of the symbolic type names for types in
-/// the specified module to the TypePrinter and all numbered types to it and the
-/// NumberedTypes table.
-static void AddModuleTypesToPrinter(TypePrinting &TP,
-                                    std::vector<const Type*> &NumberedTypes,
-                                    const Module *M) {
-  if (M == 0) return;
+PerfEvo::~PerfEvo() {}
 
-  // If the module has a symbol table, take all global types and stuff their
-  // names into the TypeNames map.
-  const TypeSymbolTable &ST = M->getTypeSymbolTable();
-  for (TypeSymbolTable::const_iterator TI = ST.begin(), E = ST.end();
-       TI != E; ++TI) {
-    const Type *Ty = cast<Type>(TI->second);
+std::string PerfEvo::intToString(int i) {
+  std::stringstream b;
+  b << i;
+  return b.str();
+}
 
-    // As a heuristic, don't insert pointer to primitive types, because
-    // they are used too often to have a single useful name.
-    if (const PointerType *PTy = dyn_cast<PointerType>(Ty)) {
-      const Type *PETy = PTy->getElementType();
-      if ((PETy->isPrimitiveType() || PETy->isIntegerTy()) &&
-          !PETy->isOpaqueTy())
-        continue;
-    }
+FindingFormat PerfEvo::getFindingFormat() {
+  return Format;
+}
 
-    // Likewise don't insert primitives either.
-    if (Ty->isIntegerTy() || Ty->isPrimitiveType())
-      continue;
+void PerfEvo::writeFinding(const Finding &R, raw_ostream &Out) {
+  ::writeFinding(R, Format, Out);
+}
 
-    // Get the name as a string and insert it into TypeNames.
-    std::string NameStr;
-    raw_string_ostream NameROS(NameStr);
-    formatted_raw_ostream NameOS(NameROS , false );
-    PrintLLVMName(NameOS, TI->first, LocalPrefix);
-    NameOS.flush();
-    TP.addTypeName(Ty, NameStr);
+FindingLoc CheckerContext::getLoc(Instruction *I, StringRef Note) {
+  FindingLoc L;
+  SourceLoc Loc;
+  if (Pass.getLocation(I, Loc)) {
+    L.File = Pass.getPath(Loc);
+    L.Line = Loc.Line;
+    L.Source = Pass.getSourceLine(Loc).str();
   }
-
-  // Walk the entire module to find references to unnamed structure and opaque
-  // types.  This is required for correctness by opaque types (because multiple
-  // uses of an unnamed opaque type needs to be referred to by the same ID) and
-  // it shrinks complex recursive structure types substantially in some cases.
-  TypeFinder(TP, NumberedTypes).Run(*M);
+  L.Note = Note.str();
+  return L;
 }
 
-///////////////////////////////
-
-
+void CheckerContext::report(Instruction *I, unsigned LoopDepth,
+                            StringRef Message) {
+  Finding R;
+  R.LoopDepth = LoopDepth;
+  R.Message = Message.str();
+  report(I, R);
+}
 
+void CheckerContext::report(Instruction *I, Finding &R) {
+  R.Loc = getLoc(I);
+  if (TripCounts && R.LoopDepth && LI)
+    if (Loop *L = LI->getLoopFor(I->getParent()))
+      R.EstimatedCount = estimateTripCount(L, SE, UnknownTripCount,
+                                           R.TripCount);
+  report(R);
+}
 
-static cl::opt<std::string> strPerfBugID("perfBugID",
-       cl::desc("Performance bug ID"), cl::Required,
-       cl::value_desc("perfBugID"));
+void CheckerContext::report(Finding &R) {
+  R.Checker = CheckerID;
+  R.Function = F.getName().str();
+  if (Pass.reportFinding(R, &F, Out))
+    ++NumFindings;
+}
 
-PerfEvo::PerfEvo() : FunctionPass(ID), Err(errs()), bBugHandlerInited(false) {}
+bool PerfEvo::reportFinding(Finding &R, const Function *F, raw_ostream &Out) {
+  if (!weighFinding(R))
+    return false;
+  if (rankFindings())
+    addRankedFinding(R, F);
+  else
+    writeFinding(R, Out);
+  return true;
+}
 
-std::string PerfEvo::intToString(int i) {
-  std::stringstream b;
-  b << i;
-  return b.str();
+bool PerfEvo::getLocation(Instruction *i, SourceLoc &Loc) {
+  return Locations.lookup(i, Loc);
 }
 
+// Only use this when the path is about to be printed; checkers that just
+// compare locations should use getLocation.
 bool PerfEvo::getPathAndLineNo(Instruction *i,
                                std::string &Path, unsigned &LineNo) {
-  LLVMContext &Ctx = i->getContext();
-  DebugLoc dl = i->getDebugLoc();
-  std::string strPath;
-  char *pPath;
-
-  // TODO: should be a while loop
-  while (MDNode *IA = dl.getInlinedAt(Ctx)) {
-    dl = DebugLoc::getFromDILocation(IA);
-  }
-
-  DILocation dil(dl.getAsMDNode(Ctx));
-  if (dil.Verify()) {
-    strPath = dil.getDirectory().str() + "/" + dil.getFilename().str();
-    pPath = canonicalize_file_name(strPath.c_str());
-    if (pPath) {
-      Path = std::string(pPath);
-      LineNo = dil.getLineNumber();
-      return true;
-    }
-  }
-  return false;
+  SourceLoc Loc;
+  if (!Locations.lookup(i, Loc))
+    return false;
+  Path = Locations.getPath(Loc.File);
+  LineNo = Loc.Line;
+  return true;
 }
 
 void PerfEvo::getAllocatedType(AllocaInst *i,
@@ -303,49 +237,17 @@ void PerfEvo::getAllocatedType(AllocaInst *i,
     assert (false && "fail to get location info!");
 }
 
-std::vector<std::string> PerfEvo::loadSourceFile(std::string s) {
-  std::vector<std::string> v;
-  std::ifstream f(s.c_str());
-
-  while(f.good()) {
-    std::string l = "";
-    getline(f, l);
-    v.push_back(l);
-  }
-
-  f.close();
-
-  return v;
-}
-
-void PerfEvo::addSourceLine(Instruction *i) {
-  std::string s;
-  unsigned l;
-  if (!getPathAndLineNo(i, s, l))
-    return;
-  if (source_files[s].empty())
-  {
-    source_files[s] = loadSourceFile(s);
-  }
+std::string PerfEvo::getSourceLine(std::string s, unsigned l) {
+  return Sources->getLine(s, l).str();
 }
 
-std::string PerfEvo::getSourceLine(std::string s, unsigned l) {
-  if (s.empty())
-    return "";
-  if ((unsigned int)l < source_files[s].size()) 
-    return source_files[s][l - 1];
-  else
-    return "";
+StringRef PerfEvo::getSourceLine(const SourceLoc &Loc) {
+  return Sources->getLine(Locations.getPath(Loc.File), Loc.Line);
 }
 
-void PerfEvo::loadSourceFiles(Module *m) {
-  for (Module::iterator f = m->begin(), fe = m->end(); f != fe; ++f) {
-    for (Function::iterator b = f->begin(), be = f->end(); b != be; ++b) {
-      for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
-        addSourceLine(i);
-      }
-    }
-  }
+bool PerfEvo::sourceLineContains(const SourceLoc &Loc, StringRef Pattern) {
+  return Sources->lineContains(Locations.getPath(Loc.File), Loc.Line,
+                               Pattern);
 }
 
 std::list<Instruction *> PerfEvo::searchCallSites(Function &F, std::string s) {
@@ -353,10 +255,10 @@ std::list<Instruction *> PerfEvo::searchCallSites(Function &F, std::string s) {
   for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) {
     for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
       if (isa<CallInst>(i) || isa<InvokeInst>(i)) {
-        std::string strPath;
-        unsigned uLineNo=0;
-        assert(getPathAndLineNo(i, strPath, uLineNo) && "No debug info");
-        if (getSourceLine(strPath, uLineNo).find(s) != std::string::npos) {
+        SourceLoc Loc;
+        bool HasLoc = getLocation(i, Loc);
+        assert(HasLoc && "No debug info");
+        if (HasLoc && sourceLineContains(Loc, s)) {
          l.push_back(i);
         }
       }
@@ -365,7 +267,7 @@ std::list<Instruction *> PerfEvo::searchCallSites(Function &F, std::string s) {
   return l;
 }
 
-BasicBlock* PerfEvo::getLoopHeader(LoopInfo &li, Loop *l) {
+BasicBlock* PerfEvo::getLoopHeader(BasicLoopInfo &li, Loop *l) {
   for (Loop::block_iterator b = l->block_begin(), 
                  be = l->block_end(); b != be; ++b) {
     if (li.isLoopHeader(*b)) {
@@ -376,17 +278,7 @@ BasicBlock* PerfEvo::getLoopHeader(LoopInfo &li, Loop *l) {
 }
 
 bool PerfEvo::containsCallSite(Function &F, const Function *T) {
-  for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) {
-    for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
-      if (isa<CallInst>(&(*i)) || isa<InvokeInst>(&(*i))) {
-        CallSite c(&*i);
-        if (c.getCalledFunction() == T) {
-         return true;
-        }
-      }
-    }
-  }
-  return false;
+  return CallSites.hasCallSite(&F, T);
 }
 
 //void PerfEvo::ApacheBug33605( Function &F )
@@ -396,91 +288,76 @@ bool PerfEvo::containsCallSite(Function &F, const Function *T) {
 
 
 
-void PerfEvo::ApacheBug45464(Function &F) 
+namespace {
+class ApacheBug45464 : public PerfEvoChecker {
+  const Type *FinfoPtrTy;
+public:
+  ApacheBug45464() : FinfoPtrTy(0) {}
+  void beginFunction(CheckerContext &C) {
+    FinfoPtrTy = C.Pass.getTypes().lookup("%struct.apr_finfo_t*");
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static const char *const ApacheBug45464Triggers[] = {
+  "apr_stat", "apr_lstat", 0
+};
+static RegisterChecker<ApacheBug45464>
+RegApacheBug45464("ApacheBug45464", FunctionScope, NoAnalyses,
+                  ApacheBug45464Triggers);
+}
+
+void ApacheBug45464::visit(Instruction *i, CheckerContext &C) 
 {
    int target_flag = 0x0073b170;
-   TypePrinting Printer;
-   std::vector<const Type *> NumberedTypes;
-   AddModuleTypesToPrinter( Printer , NumberedTypes , _M );
+   CallInst * pCall = dyn_cast<CallInst>(i);
+   if( !pCall || !FinfoPtrTy )
+   {
+       return;
+   }
 
-   for( Function::iterator b = F.begin() , be = F.end() ; b != be ; ++ b )
+   if( ConstantInt * v = dyn_cast<ConstantInt>( pCall->getArgOperand(2) ) )
    {
-       for( BasicBlock::iterator  i = b->begin() , ie = b->end() ; i != ie ; i ++ )
+       if( v->getValue() != target_flag )
        {
-           if( CallInst * pCall = dyn_cast<CallInst>(i) )
-	   {
-               Function * pFunction = pCall->getCalledFunction();
-	       if( !pFunction )
-	       {
-	           continue;
-	       }
-	       
-	       
-	       std::string sFunctionName = pFunction->getName();
-	       if( sFunctionName.find( "apr_stat" ) == std::string::npos && sFunctionName.find( "apr_lstat" ) == std::string::npos )
-	       {
-	           continue;
-	       }
-
-	       if( ConstantInt * v = dyn_cast<ConstantInt>( pCall->getArgOperand(2) ) )
-	       {
-	           if( v->getValue() != target_flag )
-		   {
-                       continue;
-		   }
-	       }
-	       else
-	       {
-	           continue;
-	       }
-
-	       if( Instruction * pi =  dyn_cast<Instruction>( pCall->getArgOperand(0) ) )
-	       {
-	           std::string sResult;
-		   raw_string_ostream rstring(sResult);
-		   Printer.print( pi->getType() , rstring );
-		   std::string sAllocatedType = rstring.str();
-		   if( sAllocatedType != "%struct.apr_finfo_t*")
-		   {
-		       continue;
-		   }
-		   
-		   
-		   std::set<int> setIndex;
-		   //bool bFlag = false;
-		   for( Value::use_iterator pu = pi->use_begin() , pue = pi->use_end() ; pu != pue ; pu ++ )
-		   {
-		       if( GetElementPtrInst * pGet = dyn_cast<GetElementPtrInst>(*pu ))
-		       {
-		           if( pGet->getNumOperands() != 3 )
-			   {
-                               continue;
-			   }
-
-			   if( ConstantInt * v = dyn_cast<ConstantInt>(pGet->getOperand(2) ) )
-			   {
-                               //std::cout << v->getValue() << std::endl;
-			       setIndex.insert( v->getValue().getLimitedValue() );
-			   }
-		       }
-
-		  }
-                  
-		  if ( setIndex.size() <  17 && setIndex.size() > 0 ) 
-		  {
-		      std::string strPath;
-		      unsigned uLineNo=0;
-		      assert(getPathAndLineNo(i, strPath, uLineNo) && "No debug info");
-		      Err << strPath << ":" << uLineNo << "\n"
-		          << getSourceLine(strPath, uLineNo) << "\n";
+           return;
+       }
+   }
+   else
+   {
+       return;
+   }
 
+   if( Instruction * pi =  dyn_cast<Instruction>( pCall->getArgOperand(0) ) )
+   {
+       if( pi->getType() != FinfoPtrTy )
+       {
+           return;
+       }
 
-	           }
+       std::set<int> setIndex;
+       //bool bFlag = false;
+       for( Value::use_iterator pu = pi->use_begin() , pue = pi->use_end() ; pu != pue ; pu ++ )
+       {
+           if( GetElementPtrInst * pGet = dyn_cast<GetElementPtrInst>(*pu ))
+           {
+               if( pGet->getNumOperands() != 3 )
+               {
+                   continue;
+               }
 
-	     }
+               if( ConstantInt * v = dyn_cast<ConstantInt>(pGet->getOperand(2) ) )
+               {
+                   //std::cout << v->getValue() << std::endl;
+                   setIndex.insert( v->getValue().getLimitedValue() );
+               }
+           }
        }
-   }
 
+       if ( setIndex.size() <  17 && setIndex.size() > 0 ) 
+       {
+           C.report(i);
+       }
    }
 
 
@@ -520,22 +397,17 @@ void PerfEvo::ApacheBug45464(Function &F)
 #endif
 }
 
-std::list<const CallSite*> PerfEvo::getCallSitesForFunction(Function &F,
-                                      const Function *T) {
-  std::list<const CallSite *> c_list;
-
-  for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) {
-    for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
-      if (isa<CallInst>(&(*i)) || isa<InvokeInst>(&(*i))) {
-        CallSite *c = new CallSite(&*i);
-        if (c->getCalledFunction() == T) {
-         c_list.push_back(c);
-        }
-      }
-    }
+const GlobalUseIndex &PerfEvo::getGlobalUses() {
+  if (!GlobalUses.isBuilt()) {
+    PhaseTimer T("global use index");
+    GlobalUses.build(*_M);
   }
-      
-  return c_list;
+  return GlobalUses;
+}
+
+const CallSiteIndex::CallList &
+PerfEvo::getCallSitesForFunction(Function &F, const Function *T) {
+  return CallSites.getCallSites(&F, T);
 }
 
 std::list<const Function*> PerfEvo::getFunctionsWithString(Module &M,
@@ -550,7 +422,26 @@ std::list<const Function*> PerfEvo::getFunctionsWithString(Module &M,
     return f_list;
 }
 
-void PerfEvo::MozillaBug267506(Function &F) {
+namespace {
+class MozillaBug267506 : public PerfEvoChecker {
+  const Type *AutoStringPtrTy;
+public:
+  MozillaBug267506() : AutoStringPtrTy(0) {}
+  void beginFunction(CheckerContext &C) {
+    AutoStringPtrTy = C.Pass.getTypes().lookup("%struct.nsCAutoString*");
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static const char *const MozillaBug267506Triggers[] = {
+  "GetDocumentCharacterSet", 0
+};
+static RegisterChecker<MozillaBug267506>
+RegMozillaBug267506("MozillaBug267506", FunctionScope, NoAnalyses,
+                    MozillaBug267506Triggers);
+}
+
+void MozillaBug267506::visit(Instruction *i, CheckerContext &C) {
 
 
    //if(F.getName().find("NewURIWithDocumentCharset") == std::string::npos)
@@ -640,75 +531,48 @@ void PerfEvo::MozillaBug267506(Function &F) {
 
    //if(F.getName().find("GetStyleSheetURL") == std::string::npos)
    //   return;
-   TypePrinting Printer;
-   std::vector<const Type *> NumberedTypes;
-   AddModuleTypesToPrinter( Printer , NumberedTypes , _M );
+  CallInst * pCall = dyn_cast<CallInst>( i );
+  if( !pCall || !AutoStringPtrTy )
+  {
+    return;
+  }
+
+  const Function *Callee = CallSiteIndex::getCallee(pCall);
+  if( !Callee || Callee->getName().find("nsIDocument") == StringRef::npos )
+  {
+    return;
+  }
 
-  for( Function::iterator b = F.begin() , be = F.end() ; 
-       b != be ; b ++ )
+  for( Value::use_iterator u = i->use_begin() , ue = i->use_end() ; u != ue ; u ++ )
   {
-    for( BasicBlock::iterator i = b->begin() , ie = b->end() ; 
-        i != ie ; i ++ )
+    if( GetElementPtrInst * pGet =  dyn_cast<GetElementPtrInst>( *u ) )
     {
-      if( CallInst * pCall = dyn_cast<CallInst>( i )  )
+      for( Value::use_iterator getU = pGet->use_begin() , getUE = pGet->use_end() ; getU != getUE ; getU ++ )
       {
-        Function * pFunction = pCall->getCalledFunction();
-	if( !pFunction )
-	{
-         continue;
-	}
-
-	std::string sFunctionName = pFunction->getName();
-        if( sFunctionName.find("nsIDocument") != std::string::npos &&  
-           sFunctionName.find( "GetDocumentCharacterSet" ) != std::string::npos )
-	{
-         for( Value::use_iterator u = i->use_begin() , ue = i->use_end() ; u != ue ; u ++ )
-         {
-          if( GetElementPtrInst * pGet =  dyn_cast<GetElementPtrInst>( *u ) )
-          {
-              for( Value::use_iterator getU = pGet->use_begin() , getUE = pGet->use_end() ; getU != getUE ; getU ++ )
-	      {
-	         if( CallInst * pCall = dyn_cast<CallInst>(* getU ) )
-		 {
-	         if( Instruction * pi =  dyn_cast<Instruction>( pCall->getArgOperand(0) ) )
-                 { 
-	       
-                    std::string sResult;
-	            raw_string_ostream rstring(sResult);
-	            Printer.print( pi->getType() , rstring );
-	            std::string sAllocatedType = rstring.str();
-               
-                    //std::cout << sAllocatedType << std::endl;
-                    if( sAllocatedType != "%struct.nsCAutoString*")
-                    {
-                       continue;
-                    }
-                    int iNum = 0 ;
-                    for( Value::use_iterator pu = pi->use_begin() , pue = pi->use_end() ; pu != pue ; pu ++ )
-                    {
-			if( isa<GetElementPtrInst>( *pu ))
-			{
-                            iNum++;
-			}
-			
-                    }
-		    //std::cout << iNum << std::endl;
-                   if( iNum == 1 )
-                   {
-	       
-	               std::string strPath;
-		       unsigned uLineNo=0;
-		       //u->dump();
-		       assert(getPathAndLineNo(i, strPath, uLineNo) && "No DebugInfo");
-		       Err << strPath << ":"<< uLineNo << "\n"
-		           << getSourceLine(strPath, uLineNo) << "\n";
-                  }
-	       }
-	       }
-	    }
+        if( CallInst * pUseCall = dyn_cast<CallInst>(* getU ) )
+        {
+          if( Instruction * pi =  dyn_cast<Instruction>( pUseCall->getArgOperand(0) ) )
+          { 
+            if( pi->getType() != AutoStringPtrTy )
+            {
+              continue;
+            }
+            int iNum = 0 ;
+            for( Value::use_iterator pu = pi->use_begin() , pue = pi->use_end() ; pu != pue ; pu ++ )
+            {
+              if( isa<GetElementPtrInst>( *pu ))
+              {
+                iNum++;
+              }
+            }
+            //std::cout << iNum << std::endl;
+            if( iNum == 1 )
+            {
+              //u->dump();
+              C.report(i);
+            }
           }
-         }
-	}
+        }
       }
     }
   }
@@ -718,7 +582,28 @@ void PerfEvo::MozillaBug267506(Function &F) {
 #endif
 }
 
-void PerfEvo::MozillaBug66461(Function &F) {
+namespace {
+class MozillaBug66461 : public PerfEvoChecker {
+  const Type *T;
+  const Function *GetGC;
+  const Function *GetDrawable;
+public:
+  MozillaBug66461() : T(0), GetGC(0), GetDrawable(0) {}
+  void beginFunction(CheckerContext &C);
+  void endFunction(CheckerContext &C);
+};
+
+static const char *const MozillaBug66461Triggers[] = {
+  "_ZN21nsRenderingContextGTK5GetGCEv",
+  "_ZN19nsDrawingSurfaceGTK11GetDrawableEv",
+  0
+};
+static RegisterChecker<MozillaBug66461>
+RegMozillaBug66461("MozillaBug66461", FunctionScope, NoAnalyses,
+                   MozillaBug66461Triggers);
+}
+
+void MozillaBug66461::beginFunction(CheckerContext &C) {
   /*
   //function to retrieve types defined by GTK
 
@@ -751,22 +636,26 @@ void PerfEvo::MozillaBug66461(Function &F) {
 
   */
 
+  Module &M = C.Pass.getModule();
+
   //target parameter type
-  const Type *T = _M->getTypeByName("struct.nsIDeviceContext");
+  T = M.getTypeByName("struct.nsIDeviceContext");
 
   //target mutator functions
-  const Function *GetGC =
-       _M->getFunction("_ZN21nsRenderingContextGTK5GetGCEv");
-  const Function *GetDrawable =
-      _M->getFunction("_ZN19nsDrawingSurfaceGTK11GetDrawableEv");
+  GetGC = M.getFunction("_ZN21nsRenderingContextGTK5GetGCEv");
+  GetDrawable = M.getFunction("_ZN19nsDrawingSurfaceGTK11GetDrawableEv");
+}
 
+void MozillaBug66461::endFunction(CheckerContext &C) {
   if (T == NULL || GetGC == NULL || GetDrawable == NULL)
     return;
   
+  Function &F = C.F;
   const FunctionType *FT = F.getFunctionType();
   bool found_t = false;
 
-  if (!(containsCallSite(F, GetGC) || containsCallSite(F, GetDrawable)))
+  const CallSiteIndex &CS = C.Pass.getCallSites();
+  if (!CS.hasCallSite(&F, GetGC) && !CS.hasCallSite(&F, GetDrawable))
     return;
 
   for (unsigned int j = 0; j < FT->getNumParams(); j++) {
@@ -783,84 +672,174 @@ void PerfEvo::MozillaBug66461(Function &F) {
     if (found_t) {
       //find the first instruction in the current instruction
       // that maps to a real source line
-      int lineNumber = -1;
+      Instruction *First = 0;
       for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) {
         for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
-         const DebugLoc d = i->getDebugLoc();
-         lineNumber = d.getLine();
-         if (0 < lineNumber)
+         if (i->getDebugLoc().getLine() > 0) {
+           First = i;
            break;
+         }
         }
-        if (0 < lineNumber)
+        if (First)
          break;
       }
-      
-      Err << "Possible skippable function (" << F.getNameStr()
-         << ") found at line: " << lineNumber << "\n";
+
+      Finding R;
+      if (First)
+        R.Loc = C.getLoc(First);
+      R.Message = "possible skippable function";
+      C.report(R);
       
       break;
     }
   }
 }
 
-void PerfEvo::MozillaBug35294(Function &F) {
-  LoopInfo &li = getAnalysis<LoopInfo>();
+namespace {
+/// LoopCallGrepChecker - Report calls inside loops whose source line
+/// contains Pattern.
+class LoopCallGrepChecker : public PerfEvoChecker {
+  const char *Pattern;
+public:
+  explicit LoopCallGrepChecker(const char *P) : Pattern(P) {}
+  void getInterest(CheckerInterest &I) const {
+    I.Opcodes.push_back(Instruction::Call);
+    I.Opcodes.push_back(Instruction::Invoke);
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+class MozillaBug35294 : public LoopCallGrepChecker {
+public:
+  MozillaBug35294() : LoopCallGrepChecker("RemoveChildAt") {}
+};
+
+class MozillaBug311566 : public LoopCallGrepChecker {
+public:
+  MozillaBug311566() : LoopCallGrepChecker("Append(") {}
+};
+
+class LoopNestedCallSites : public LoopCallGrepChecker {
+public:
+  LoopNestedCallSites() : LoopCallGrepChecker("") {}
+};
+
+static RegisterChecker<MozillaBug35294>
+RegMozillaBug35294("MozillaBug35294", FunctionScope, NeedsLoopInfo);
+static RegisterChecker<MozillaBug311566>
+RegMozillaBug311566("MozillaBug311566", FunctionScope, NeedsLoopInfo);
+static RegisterChecker<LoopNestedCallSites>
+RegLoopNestedCallSites("LoopNestedCallSites", FunctionScope, NeedsLoopInfo);
+}
+
+void LoopCallGrepChecker::visit(Instruction *i, CheckerContext &C) {
+  BasicBlock *bb = i->getParent();
+  unsigned int ld = C.LI->getLoopDepth(bb);
 
-  std::list<Instruction *> csl = searchCallSites(F, "RemoveChildAt");
+  if (ld == 0)
+    return;
 
-  for (std::list<Instruction *>::iterator cs = csl.begin(), cse = csl.end(); 
-      cs != cse; ++cs) {
-    BasicBlock *bb = (*cs)->getParent();
-    unsigned int ld = li.getLoopDepth(bb);
-        
-    if (ld > 0) {
-      if (true) {
-        std::string strPath;
-        unsigned uLineNo=0;
-        assert(getPathAndLineNo(*cs, strPath, uLineNo) && "No DebugInfo");
+  SourceLoc Loc;
+  bool HasLoc = C.Pass.getLocation(i, Loc);
+  assert(HasLoc && "No DebugInfo");
+  if (!HasLoc)
+    return;
 
-        Err << strPath << ":" << uLineNo << "\n"
-            << getSourceLine(strPath, uLineNo) << "\n"
-            << "LoopDepth: " << li.getLoopDepth(bb) << "\n";
+  if (!C.Pass.sourceLineContains(Loc, Pattern))
+    return;
 
-      }
+  C.report(i, ld);
+}
 
-      // errs() << *scev << "\n";
+static cl::list<std::string> ExpensiveCalls("perfExpensiveCalls",
+       cl::desc("Callee name substrings LoopCallChains treats as expensive "
+                "(default RemoveChildAt,Append)"),
+       cl::CommaSeparated, cl::value_desc("name"));
 
-    }
-  }
+namespace {
+/// LoopCallChains - Report calls inside loops that reach an expensive call,
+/// such as RemoveChildAt, through other functions.  Calls of the expensive
+/// functions themselves are left to the loop grep checkers.
+class LoopCallChains : public PerfEvoChecker {
+public:
+  void runOnModule(PerfEvo &Pass, raw_ostream &Out);
+};
+
+static RegisterChecker<LoopCallChains>
+RegLoopCallChains("LoopCallChains", ModuleScope, NoAnalyses);
 }
 
-void PerfEvo::MozillaBug311566(Function &F) {
-  LoopInfo &li = getAnalysis<LoopInfo>();
+void LoopCallChains::runOnModule(PerfEvo &Pass, raw_ostream &Out) {
+  static const char *const DefaultCalls[] = { "RemoveChildAt", "Append", 0 };
+  std::vector<std::string> Patterns(ExpensiveCalls.begin(),
+                                    ExpensiveCalls.end());
+  // An empty substring would match every callee.
+  for (unsigned i = 0, e = Patterns.size(); i != e; ++i)
+    if (Patterns[i].empty())
+      report_fatal_error("-perfExpensiveCalls: empty name in the list");
+  if (Patterns.empty())
+    for (const char *const *P = DefaultCalls; *P; ++P)
+      Patterns.push_back(*P);
+
+  CalleeMatcher Expensive;
+  for (unsigned i = 0, e = Patterns.size(); i != e; ++i)
+    Expensive.add(Patterns[i], i);
+  Expensive.compile();
+
+  Module &M = Pass.getModule();
+  const CallSiteIndex &CallSites = Pass.getCallSites();
+  CallGraphSummary Summaries;
+  Summaries.build(M, CallSites, Expensive);
 
-  std::list<Instruction *> csl = searchCallSites(F, "Append(");
+  for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f) {
+    if (f->isDeclaration())
+      continue;
 
-  for (std::list<Instruction *>::iterator cs = csl.begin(), cse = csl.end(); 
-      cs != cse; ++cs) {
-    BasicBlock *bb = (*cs)->getParent();
-    unsigned int ld = li.getLoopDepth(bb);
+    // Loops are only needed where a call reaches something expensive.
+    const CallSiteIndex::CalleeMap &Callees = CallSites.getCallees(f);
+    bool Reaches = false;
+    for (CallSiteIndex::CalleeMap::const_iterator I = Callees.begin(),
+         E = Callees.end(); I != E && !Reaches; ++I)
+      Reaches = Summaries.getSummary(I->first) != 0;
+    if (!Reaches)
+      continue;
 
-    if (ld > 0) {
-      std::string strPath;
-      unsigned uLineNo=0;
-      assert(getPathAndLineNo(*cs, strPath, uLineNo) && "No DebugInfo");
+    DominatorTreeBase<BasicBlock> DT(false);
+    DT.recalculate(*f);
+    BasicLoopInfo LI;
+    LI.Calculate(DT);
+    CheckerContext C(Pass, "LoopCallChains", *f, &LI, 0, Out);
 
-      Err << strPath << ":" << uLineNo << "\n"
-          << getSourceLine(strPath, uLineNo) << "\n"
-          << "LoopDepth: " << li.getLoopDepth(bb) << "\n";
+    for (Function::iterator b = f->begin(), be = f->end(); b != be; ++b) {
+      unsigned Depth = LI.getLoopDepth(b);
+      if (!Depth)
+        continue;
+      for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
+        const Function *Callee = CallSiteIndex::getCallee(i);
+        if (!Callee || !Summaries.getSummary(Callee))
+          continue;
+
+        SmallVector<Instruction*, 8> Path;
+        Summaries.getWitnessPath(Callee, Path);
+        Finding R;
+        R.LoopDepth = Depth;
+        for (unsigned k = 0, ke = Path.size(); k != ke; ++k) {
+          const Function *Next = CallSiteIndex::getCallee(Path[k]);
+          R.Related.push_back(C.getLoc(Path[k], "calls " + Next->getNameStr()));
+        }
+        const Function *Last = CallSiteIndex::getCallee(Path.back());
+        R.Message = "call reaches " + Last->getNameStr() + " through " +
+                    utostr(Path.size() + 1) + " calls";
+        C.report(i, R);
+      }
     }
-  }      
+  }
 }
 
 
 
 std::string PerfEvo::getFunctionName( CallInst * i )
 {
-     TypePrinting Printer;
-     std::vector<const Type *> NumberedTypes;
-     AddModuleTypesToPrinter( Printer , NumberedTypes , _M );
-
     Function * pFunction = i->getCalledFunction();
     std::string sFunctionName;
     if( pFunction )
@@ -880,8 +859,29 @@ std::string PerfEvo::getFunctionName( CallInst * i )
 }
 
 
-void PerfEvo::MozillaBug103330(Function &F) 
-{
+namespace {
+class MozillaBug103330 : public PerfEvoChecker {
+  // Built for the current function at the first SetLength(0) call.
+  OwningPtr<BlockReachability> Reach;
+  // The blocks of the function that are in a loop.
+  BitVector InLoop;
+public:
+  void getInterest(CheckerInterest &I) const {
+    I.Opcodes.push_back(Instruction::Alloca);
+  }
+  void beginFunction(CheckerContext &C) {
+    Reach.reset();
+    InLoop.clear();
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static RegisterChecker<MozillaBug103330>
+RegMozillaBug103330("MozillaBug103330", FunctionScope, NeedsLoopInfo);
+}
+
+void MozillaBug103330::visit(Instruction *i, CheckerContext &C) 
+{
     //if( F.getName().find( "GetStringValue" ) == std::string::npos) //|| F.getName().find( "AtomImpl" ) == std::string::npos )
     //{
     //   return;
@@ -889,259 +889,106 @@ void PerfEvo::MozillaBug103330(Function &F)
 
 
 #if 1
-   TypePrinting Printer;
-   std::vector<const Type *> NumberedTypes;
-   AddModuleTypesToPrinter( Printer, NumberedTypes , _M );
-   
-   LoopInfo *LI = &getAnalysis<LoopInfo>();
-
-   for( Function::iterator b = F.begin() , be = F.end() ; b != be ; b ++ )
-   {
-      for( BasicBlock::iterator i = b->begin() , ie = b->end() ; i != ie ; i ++ )
-      {
-          if( AllocaInst * pAlloc = dyn_cast<AllocaInst>(i) )
-	  {
-              std::string sResult;
-	      raw_string_ostream rstring( sResult );
-	      Printer.print( pAlloc->getType() , rstring );
-	      std::string sAllocatedType = rstring.str() ;
+   BasicLoopInfo *LI = C.LI;
 
-	      if( sAllocatedType.find("struct.nsAString") == std::string::npos )
-	      {
-                  continue;
-	      }
-              //std::cout << sAllocatedType << std::endl;
-	      for( Value::use_iterator su = pAlloc->use_begin() , sue = pAlloc->use_end() ; su != sue ; su ++ )
-	      {
-                  if( LoadInst * pLoad = dyn_cast<LoadInst>( *su ) )
-		  {   
-		      if( pLoad->use_begin() == pLoad->use_end() )
-		      {
-                           continue;
-		      }
-                      Value::use_iterator useLoad = pLoad->use_begin();
-		      if( CallInst * pCall = dyn_cast<CallInst>( * useLoad) )
-		      {
-                          if( pCall->getNumArgOperands() != 2 )
-			  {
-                              continue;
-			  }
-
-			  if( ConstantInt * pConstant = dyn_cast<ConstantInt>(pCall->getOperand(1) ) )
-			  {
-                               APInt apInt = pConstant->getValue();
-			       std::string sValue = apInt.toString( 10 , 0 );
-
-			       if( sValue != "0")
-			       {
-			          continue;
-			       }
-                               
-			       std::string sFunctionName = getFunctionName( pCall );
-			       if( sFunctionName.find("SetLength") == std::string::npos )
-			       {
-                                  continue;
-			       }
-
-			       //std::string strPath;
-			       //unsigned uLineNo;
-			       //getPathAndLineNo( pCall , strPath , uLineNo );
-			       //std::cout << strPath << " : " << uLineNo << std::endl;
-                               //std::cout << "Find setLength" << std::endl;                       
-			       //check current blocl
-                               bool bFlag = false;
-			       BasicBlock * bParent = pCall->getParent();
-                               BasicBlock::iterator itInstruction = bParent->begin() ;
-			       while( true )
-			       {
-                                   if(pCall->isIdenticalTo( itInstruction ))
-				   {
-				      break;
-				   }
+   AllocaInst * pAlloc = cast<AllocaInst>(i);
+   StringRef sAllocatedType = C.Pass.getTypes().getName( pAlloc->getType() );
 
-				   itInstruction++;
-			       }
-
-			       itInstruction++; 
-			       //std::cout << "before inside block " << std::endl;
-		               for( BasicBlock::iterator itInstructionEnd = bParent->end() ; itInstruction != itInstructionEnd ; itInstruction ++ )
-			       {
-                                   for( Value::use_iterator suInstruction = pAlloc->use_begin() , sueInstruction = pAlloc->use_end() ; suInstruction != sueInstruction ; suInstruction ++ )
-				   {
-				       if( Instruction * pInstruction = dyn_cast<Instruction>( *suInstruction) )
-				       {
-                                          if( itInstruction->isIdenticalTo(  pInstruction) )
-				          {
-
-				            if( LoadInst * pNextLoad = dyn_cast<LoadInst>( itInstruction ) )
-					    {
-					        if( pNextLoad->use_begin() != pNextLoad->use_end() )
-						{
-
-					
-					        
-                                                Value::use_iterator nextCall = pNextLoad->use_begin();
-						if( CallInst * pNextCall = dyn_cast<CallInst>( *nextCall ) )
-						{
-                                                     std::string sAppend = getFunctionName( pNextCall );
-
-						     if( sAppend.find("Append") != std::string::npos )
-						     {
-                                                         std::string strPath;
-							 unsigned uLineNo;
-							 getPathAndLineNo(pCall, strPath, uLineNo);
-							 std::cout << strPath << " : " << uLineNo << std::endl;
-							 std::cout << "\t" << getSourceLine( strPath, uLineNo)  << std::endl;
-							 getPathAndLineNo( pNextCall , strPath , uLineNo );
-							 std::cout << strPath << " : " << uLineNo << std::endl;
-							 std::cout << "\t" << getSourceLine(strPath ,uLineNo ) << std::endl;
-							 std::cout << "=============================" << std::endl;
-						     }
-						}
-						}
-					    }
-
-                                            bFlag = true;
-					    break;
-				         }
-				       }
-				   }
-
-				   if(bFlag)
-				   {
-                                      break;
-				   }
-			       }
+   if( sAllocatedType.find("struct.nsAString") == StringRef::npos )
+   {
+       return;
+   }
+   //std::cout << sAllocatedType << std::endl;
+   for( Value::use_iterator su = pAlloc->use_begin() , sue = pAlloc->use_end() ; su != sue ; su ++ )
+   {
+       if( LoadInst * pLoad = dyn_cast<LoadInst>( *su ) )
+       {
+           if( pLoad->use_begin() == pLoad->use_end() )
+           {
+                continue;
+           }
+           Value::use_iterator useLoad = pLoad->use_begin();
+           if( CallInst * pCall = dyn_cast<CallInst>( * useLoad) )
+           {
+               if( pCall->getNumArgOperands() != 2 )
+               {
+                   continue;
+               }
 
-                               //std::cout << bParent->getNameStr() << std::endl;                              
-			       if( bFlag )
-			       {
-                                   continue;
-                               }
-			       //std::cout << "before next block" << std::endl;
-                               
-			       std::vector< std::vector<succ_iterator > > vectorIt;
-                               std::vector<std::string> vecVisit;
-                               
-			       std::vector< succ_iterator > vecTmp;
-			       vecTmp.push_back( succ_begin(bParent) );
-			       vecTmp.push_back( succ_end( bParent ) );
-                               vectorIt.push_back( vecTmp );			       
-                               vecVisit.push_back( bParent->getNameStr() );
-                               //std::cout << bParent->getNameStr() << std::endl;
-			       while( vectorIt.size() > 0 )
-			       {
-			           bool bInnerFlag = false; 
-                                   if( vectorIt[vectorIt.size()-1][0] == vectorIt[vectorIt.size()-1][1])
-				   {
-                                       vecVisit.pop_back();
-                                       vectorIt.pop_back();
-				       continue;
-				   }
+               if( ConstantInt * pConstant = dyn_cast<ConstantInt>(pCall->getOperand(1) ) )
+               {
+                    APInt apInt = pConstant->getValue();
+                    std::string sValue = apInt.toString( 10 , 0 );
 
-				  succ_iterator itBasicBlock = vectorIt[vectorIt.size() - 1][0];
-                                  vectorIt[vectorIt.size() -1][0]++;
-                                  
-				  if( LI->getLoopDepth( *itBasicBlock ) > 0 )
-				  {
-                                      continue;
-				  }
-				  
-				  std::vector< std::string >::iterator itBegin = vecVisit.begin();
-				  std::vector< std::string >::iterator itEnd = vecVisit.end();
-				  std::string sName = itBasicBlock->getNameStr();
-                                  //std::cout << sName << std::endl;
-				  while( itBegin != itEnd )
-				  {
-                                      if( (*itBegin) == sName )
-				      {
-                                          bInnerFlag = true;
-					  break;
-				      }
-				      itBegin ++;
-				  } 
+                    if( sValue != "0")
+                    {
+                       continue;
+                    }
 
-                                  if( bInnerFlag )
-				  { 
-                                      continue;
-				  }
+                    std::string sFunctionName = C.Pass.getFunctionName( pCall );
+                    if( sFunctionName.find("SetLength") == std::string::npos )
+                    {
+                       continue;
+                    }
 
-			          for( BasicBlock::iterator itInstruction = itBasicBlock->begin() , itInstructionEnd = itBasicBlock->end() ; itInstruction != itInstructionEnd ; itInstruction++ )
-				  {
-                                       for( Value::use_iterator suInstruction = pAlloc->use_begin() , sueInstruction = pAlloc->use_end() ; suInstruction != sueInstruction ; suInstruction ++ )
-				       {
-				           if( Instruction * pInstruction = dyn_cast<Instruction>( *suInstruction ) )
-					   {
-                                               if( pInstruction->isIdenticalTo( itInstruction )  )
-					       {
-                                                   if( LoadInst * pNextLoad = dyn_cast<LoadInst>( itInstruction ) )
-                                                   {
-						       if( pNextLoad->use_begin() != pNextLoad->use_end() )
-						       {
-                                                           Value::use_iterator nextCall = pNextLoad->use_begin();
-                                                           if( CallInst * pNextCall = dyn_cast<CallInst>( *nextCall ) )
-						           {
-						                std::string sAppend = getFunctionName( pNextCall );
-							        if( sAppend.find("Append") != std::string::npos )
-							        {
-							           std::string strPath;
-								   unsigned uLineNo;
-								   getPathAndLineNo(pCall, strPath, uLineNo);
-								   std::cout << strPath << " : " << uLineNo << std::endl;
-								   std::cout << "\t" << getSourceLine( strPath, uLineNo)  
-								           << std::endl;getPathAndLineNo( pNextCall , strPath , uLineNo );
-							           std::cout << strPath << " : " << uLineNo << std::endl;
-								   std::cout << "\t" << getSourceLine(strPath ,uLineNo ) << std::endl;
-								   std::cout << "=============================" << std::endl;
-						                }
-						           }
-							}
-						   }
-                                                   //pInstruction->dump();
-                                                   bInnerFlag = true;
-						   break;
-					       }
-					   }
-
-				       }
-
-				       if( bInnerFlag )
-				       {
-                                           break;
-				       }
-									    
-				   }
+                    //std::string strPath;
+                    //unsigned uLineNo;
+                    //C.Pass.getPathAndLineNo( pCall , strPath , uLineNo );
+                    //std::cout << strPath << " : " << uLineNo << std::endl;
+                    //std::cout << "Find setLength" << std::endl;
+                    // Look for the next use of the string on every path
+                    // out of the call, outside loops like the original
+                    // search.
+                    if( !Reach )
+                    {
+                        Reach.reset( new BlockReachability( C.F ) );
+                        InLoop.resize( Reach->size() );
+                        for( unsigned n = 0 , ne = Reach->size() ; n != ne ; n ++ )
+                        {
+                            if( LI->getLoopDepth( Reach->getBlock( n ) ) > 0 )
+                            {
+                                InLoop.set( n );
+                            }
+                        }
+                    }
 
+                    SmallVector<Instruction *, 4> vecNextUses;
+                    Reach->findNextUses( pCall , pAlloc , &InLoop , vecNextUses );
+                    for( unsigned k = 0 , ke = vecNextUses.size() ; k != ke ; k ++ )
+                    {
+                        LoadInst * pNextLoad = dyn_cast<LoadInst>( vecNextUses[k] );
+                        if( !pNextLoad || pNextLoad->use_begin() == pNextLoad->use_end() )
+                        {
+                            continue;
+                        }
 
-				   
-				   if( bInnerFlag )
-				   {
-				       
-				   }
-				   else
-				   {
-				       std::vector<succ_iterator> vecTmp;
-				       vecTmp.push_back( succ_begin(*itBasicBlock) );
-				       vecTmp.push_back( succ_end( *itBasicBlock) );
-				       vectorIt.push_back( vecTmp );
-                                       vecVisit.push_back( itBasicBlock->getNameStr());
+                        CallInst * pNextCall = dyn_cast<CallInst>( *pNextLoad->use_begin() );
+                        if( !pNextCall )
+                        {
+                            continue;
+                        }
 
-				   }
-                               }
-
-			  }
-		      }
-		      else
-		      {
-		          continue;
-		      }
-		  }
-	      }
-	  }
-      }
+                        std::string sAppend = C.Pass.getFunctionName( pNextCall );
+                        if( sAppend.find("Append") != std::string::npos )
+                        {
+                            Finding R;
+                            R.Loc = C.getLoc( pCall );
+                            R.Related.push_back( C.getLoc( pNextCall , "appended to here" ) );
+                            R.Message = "string truncated with SetLength(0) and then appended to";
+                            C.report( R );
+                        }
+                    }
 
+               }
+           }
+           else
+           {
+               continue;
+           }
+       }
    }
 
+
 #endif
 
 #if 0
@@ -1333,77 +1180,103 @@ void PerfEvo::MozillaBug103330(Function &F)
    return;
 #endif
 }
-void PerfEvo::MozillaBug258793(Function &F) {
+namespace {
+/// UnimplementedChecker - Known bugs for which no checker has been written
+/// yet.  They are accepted by -perfBugID but never look at anything.
+class UnimplementedChecker : public PerfEvoChecker {};
+
+class MozillaBug258793 : public UnimplementedChecker {};
+class MySQLBug26527 : public UnimplementedChecker {};
+class MySQLBug38941 : public UnimplementedChecker {};
+class MySQLBug38824 : public UnimplementedChecker {};
+
+static RegisterChecker<MozillaBug258793>
+RegMozillaBug258793("MozillaBug258793", FunctionScope, NoAnalyses);
+static RegisterChecker<MySQLBug26527>
+RegMySQLBug26527("MySQLBug26527", FunctionScope, NoAnalyses);
+static RegisterChecker<MySQLBug38941>
+RegMySQLBug38941("MySQLBug38941", FunctionScope, NoAnalyses);
+static RegisterChecker<MySQLBug38824>
+RegMySQLBug38824("MySQLBug38824", FunctionScope, NoAnalyses);
+
+class MozillaBug409961 : public PerfEvoChecker {
+public:
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static const char *const MozillaBug409961Triggers[] = {
+  "_ZN13nsCOMPtr_base25assign_from_qi_with_error"
+  "ERK25nsQueryInterfaceWithErrorRK4nsID",
+  0
+};
+static RegisterChecker<MozillaBug409961>
+RegMozillaBug409961("MozillaBug409961", FunctionScope, NeedsLoopInfo,
+                    MozillaBug409961Triggers);
 }
 
-void PerfEvo::MozillaBug409961(Function &F) {
-  LoopInfo &LI = getAnalysis<LoopInfo>();
-  unsigned min = 999999999;
-  unsigned max = 0;
-  bool bNeedSrcDump = false;
-  std::string strPath;
-  unsigned uLineNo;
+void MozillaBug409961::visit(Instruction *i, CheckerContext &C) {
+  BasicLoopInfo &LI = *C.LI;
+  BasicBlock *b = i->getParent();
 
-  for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) {
-    for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
-      bool ret = getPathAndLineNo(i, strPath, uLineNo);
-      if (ret) {
-        if (uLineNo > max)
-          max = uLineNo;
-        if (uLineNo < min)
-          min = uLineNo;
-      }
-      if (LI.getLoopDepth(&*b) == 0 && !LI.isLoopHeader(&*b))
-        continue;
+  if (LI.getLoopDepth(b) == 0 && !LI.isLoopHeader(b))
+    return;
 
-      if (CallInst* callInst = dyn_cast<CallInst>(&*i)) {
-        if (! callInst->getCalledFunction()
-            || callInst->getCalledFunction()->getNameStr() !=
-               "_ZN13nsCOMPtr_base25assign_from_qi_with_error\
-ERK25nsQueryInterfaceWithErrorRK4nsID"
-         ) {
-         continue;
-        }
-      }
-#if 0
-      else if (InvokeInst* invokeInst = dyn_cast<InvokeInst>(&*i)) {
-        if (invokeInst->getCalledFunction()->getNameStr() !=
+  if (CallInst* callInst = dyn_cast<CallInst>(i)) {
+    const Function *Callee = CallSiteIndex::getCallee(callInst);
+    if (! Callee
+        || Callee->getName() !=
            "_ZN13nsCOMPtr_base25assign_from_qi_with_error\
 ERK25nsQueryInterfaceWithErrorRK4nsID"
-         ) {
-         continue;
-        }
-      }
-#endif
-      else
-        continue;
-      i->dump();
-      assert(ret && "No DebugInfo");
-      bNeedSrcDump = true;
-      Err << strPath << ":" << uLineNo << "\n"
-          << getSourceLine(strPath, uLineNo) << "\n"
-         << "LoopDepth: " << LI.getLoopDepth(&*b) << "\n"
-         << "isLoopHeader: " << LI.isLoopHeader(&*b) << "\n\n";
+     ) {
+     return;
     }
   }
-  max += 5;
-  if (bNeedSrcDump) {
-    for (uLineNo = min -5; uLineNo < max; ++uLineNo)
-      Err << getSourceLine(strPath, uLineNo) << "\n";
+#if 0
+  else if (InvokeInst* invokeInst = dyn_cast<InvokeInst>(i)) {
+    if (invokeInst->getCalledFunction()->getNameStr() !=
+       "_ZN13nsCOMPtr_base25assign_from_qi_with_error\
+ERK25nsQueryInterfaceWithErrorRK4nsID"
+     ) {
+     return;
+    }
   }
+#endif
+  else
+    return;
+  C.report(i, LI.getLoopDepth(b),
+           LI.isLoopHeader(b) ? "QueryInterface in loop header"
+                              : "QueryInterface in loop");
 }
 
-void PerfEvo::MySQLBug26527(Function &F) {
+namespace {
+class MySQLBug38968 : public PerfEvoChecker {
+public:
+  void runOnModule(PerfEvo &Pass, raw_ostream &Out);
+};
+
+static RegisterChecker<MySQLBug38968>
+RegMySQLBug38968("MySQLBug38968", ModuleScope, NoAnalyses);
 }
-void PerfEvo::MySQLBug38941(Function &F) {
+
+/// noteMutexCall - If I is a call, remember it in First if it initializes
+/// or destroys the mutex, or set Used if it does anything else.
+static void noteMutexCall(Instruction *I,
+                          const std::set<std::string> &InitDestroy,
+                          Instruction *&First, bool &Used) {
+  if (!isa<CallInst>(I))
+    return;
+  const Function *Callee = CallSiteIndex::getCallee(I);
+  if (!Callee)
+    return;
+  if (!InitDestroy.count(Callee->getName()))
+    Used = true;
+  else if (!First)
+    First = I;
 }
-void PerfEvo::MySQLBug38968() 
+
+void MySQLBug38968::runOnModule(PerfEvo &Pass, raw_ostream &Out)
 {
-  //std::cout << "In 38968" << std::endl;
-  TypePrinting Printer;
-  std::vector<const Type *> NumberedTypes;
-  AddModuleTypesToPrinter( Printer , NumberedTypes, _M);
-  //std::set<std::string> setAllFunction;
+  Module &M = Pass.getModule();
   std::set<std::string> setInit_Destroy;
   setInit_Destroy.insert( "mutex_create_func" );
   setInit_Destroy.insert( "mutex_free" );
@@ -1411,558 +1284,1140 @@ void PerfEvo::MySQLBug38968()
   setInit_Destroy.insert( "os_fast_mutex_free" );
   setInit_Destroy.insert( "pthread_mutex_init");
   setInit_Destroy.insert( "pthread_mutex_destroy" );
-  std::set<std::string> setAllFunction;
-  for (Module::global_iterator v = _M->global_begin(), ve = _M->global_end();
-          v !=  ve; ++v) {
-        std::string sResult;
-        raw_string_ostream rstring(sResult);
-        Printer.print( v->getType() , rstring );       
-        //std::set<std::string> setAllFunction;
-        std::string sAllocatedType = rstring.str();
-        if( sAllocatedType.find("pthread_mutex_t") != std::string::npos) //== "%union.os_fast_mutex_t*"  )
-        {  
-	   std::cout << sAllocatedType  << std::endl;
-           //continue;
-	   std::set< std::string > setFunctionUsed; 
-	   //if( v->getNameStr() != "srv_innodb_monitor_mutex" )
-	   //{
-	   //   continue;
-	   //}
-
-           //for( Value::use_iterator u = v->use_begin(),  ue = v->use_end() ; u != ue ; u ++ )
-	   //{
-           //    u->dump();
-	   //}
-
-           for( Value::use_iterator u = v->use_begin() , ue = v->use_end() ; u != ue ; u ++ )
-           {
-               if( CallInst * pCall =  dyn_cast<CallInst>(*u) )
-	       {
-                   Function * pFunction = pCall->getCalledFunction();
-	           if(!pFunction)
-	           {
-                      continue;
-	           }
-
-	           std::string fname = pFunction->getName();
-		   if( setInit_Destroy.find( fname ) == setInit_Destroy.end() )
-		   {
-                       setFunctionUsed.insert( fname );
-		   }
-                   //setFunctionUsed.insert( fname );
-		   setAllFunction.insert( fname );
-               }
-	       else
-	       {
-	          //std::cout << "else" << std::endl;
-	          // u->dump();
-                  
-		  for( Value::use_iterator uP = u->use_begin() , ueP = u->use_end() ; uP != ueP ; uP ++ )
-		  {
-                      if( CallInst * pCall = dyn_cast<CallInst>( *uP ) )
-		      {
-                          Function * pFunction = pCall->getCalledFunction();
-			  if( !pFunction )
-			  {
-                              continue;
-			  }
-			  std::string fname = pFunction->getName();
-			  if( setInit_Destroy.find( fname ) == setInit_Destroy.end() )
-			  {
-                              setFunctionUsed.insert( fname );
-			  }
-			  //setFunctionUsed.insert( fname );
-			  setAllFunction.insert( fname );
-		      }
-		  }
-	       }
-               //std::cout << "=============================" << std::endl;
-           }
-         
-	   std::string sMutexName = v->getNameStr() ;
 
-           if( setFunctionUsed.size() == 0 )
-	   {
-	       std::cout << "==============================" << std::endl;
-               std::cout << "* bugs:  " << sMutexName << std::endl;
-	       std::cout << "==============================" << std::endl;
-	   }
-           else
-	   {
-	       std::cout << "==============================" << std::endl;
-	       std::cout << "* good practice: " << sMutexName << std::endl;
-	       std::cout << "==============================" << std::endl;
-           }
+  const GlobalUseIndex &Uses = Pass.getGlobalUses();
+  for (Module::global_iterator v = M.global_begin(), ve = M.global_end();
+       v != ve; ++v) {
+    StringRef sAllocatedType = Pass.getTypes().getName( v->getType() );
+    if( sAllocatedType.find("pthread_mutex_t") == StringRef::npos )
+      continue;
 
+    // The mutex is used if any call other than its initialization or
+    // destruction is passed the mutex or a field of it, or, for a pointer
+    // to a mutex, the pointer loaded from the global.
+    const GlobalUseIndex::UseList &L = Uses.getUses( v );
+    Instruction *First = 0;
+    bool bUsed = false;
+    for (unsigned i = 0, e = L.size(); i != e && !bUsed; ++i) {
+      if( LoadInst *pLoad = dyn_cast<LoadInst>( L[i] ) )
+      {
+        for (Value::use_iterator u = pLoad->use_begin(),
+             ue = pLoad->use_end(); u != ue && !bUsed; ++u)
+          if( Instruction *pUser = dyn_cast<Instruction>( *u ) )
+            noteMutexCall( pUser, setInit_Destroy, First, bUsed );
+        continue;
+      }
+      noteMutexCall( L[i], setInit_Destroy, First, bUsed );
+    }
+    if( bUsed )
+      continue;
 
-	   //std::set<std::string>::iterator itBegin = setFunctionUsed.begin();
-	   //while( itBegin != setFunctionUsed.end() )
-	   //{
-           //    std::cout << ( * itBegin ) << std::endl;
-	   //    itBegin++;
-	   //}
+    Finding R;
+    R.Message = "mutex " + v->getNameStr() + " is only initialized and destroyed";
+    if( First )
+    {
+      CheckerContext C(Pass, "MySQLBug38968", *First->getParent()->getParent(),
+                       0, 0, Out);
+      C.report( First , R );
+    }
+    else
+    {
+      R.Checker = "MySQLBug38968";
+      Pass.reportFinding( R , 0 , Out );
+    }
+  }
+}
 
-	   //std::cout << "==================================" << std::endl;
+static bool isBlockingCall(StringRef Name) {
+  // Exact names: "read" and "write" as substrings would match too much.
+  static const char *const BlockingCalls[] = {
+    "read", "write", "pread", "pwrite", "readv", "writev", "open", "close",
+    "fsync", "fdatasync", "send", "recv", "sendto", "recvfrom",
+    "fopen", "fclose", "fread", "fwrite", "fflush", "fputs", "fgets",
+    "printf", "fprintf", "puts",
+    "my_read", "my_write", "my_pread", "my_pwrite", "my_open", "my_close",
+    "my_fopen", "my_fclose", "my_sync", "os_file_read", "os_file_write",
+    "os_file_flush",
+    "malloc", "calloc", "realloc", "free", "my_malloc", "my_free",
+    "_Znwm", "_Znwj", "_Znam", "_Znaj", "_ZdlPv", "_ZdaPv", 0
+  };
+  for (const char *const *B = BlockingCalls; *B; ++B)
+    if (Name == *B)
+      return true;
+  return false;
+}
 
-	   /*std::string sMutexName = v->getNameStr() ;
-	   if( setFunctionUsed.find( "pthread_mutex_init" ) == setFunctionUsed.end() 
-	       && setFunctionUsed.find( "pthread_mutex_destroy" ) == setFunctionUsed.end()
-	      )
-	   {
-              std::cout << sMutexName << " : situation 1"  << std::endl;
-              std::cout << sMutexName << " : " << setFunctionUsed.size() << std::endl;
-	      std::set<std::string>::iterator itBegin = setFunctionUsed.begin();
-	      while( itBegin != setFunctionUsed.end() )
-	      {
-                   std::cout << (*itBegin) << std::endl;
-		   itBegin++;
-	      }
-	      std::cout << "===============================" << std::endl; 
-	   }
-         
-	   if( setFunctionUsed.find("pthread_mutex_init") != setFunctionUsed.end()
-	       && setFunctionUsed.find("pthread_mutex_destroy") != setFunctionUsed.end() 
-	       && setFunctionUsed.find("pthread_mutex_lock") == setFunctionUsed.end() 
-	       && setFunctionUsed.find( "pthread_mutex_unlock" ) == setFunctionUsed.end() )
-	   {
-               std::cout << sMutexName << " : situation 2" << std::endl;
-	       std::cout << sMutexName << " : " << setFunctionUsed.size() << std::endl;
-	       std::set<std::string>::iterator itBegin = setFunctionUsed.begin() ;
-	       while( itBegin != setFunctionUsed.end() ) 
-	       {
-                   std::cout << (*itBegin) << std::endl;
-		   itBegin ++;
-	       }
-	       std::cout << "================================" << std::endl;
-	   }*/
+/// describeObject - A short name for the lock object V.
+static std::string describeObject(const Value *V) {
+  if (V->hasName())
+    return V->getNameStr();
+  if (const GEPOperator *GEP = dyn_cast<GEPOperator>(V)) {
+    const Value *Base = GEP->getPointerOperand()->stripPointerCasts();
+    if (Base->hasName())
+      return "a field of " + Base->getNameStr();
+  }
+  std::string S;
+  raw_string_ostream OS(S);
+  WriteAsOperand(OS, V, false);
+  return OS.str();
+}
 
+/// getObjectKey - A name for the object V points to that is the same at every
+/// mention of it: locals and globals by identity, their fields by the base
+/// and the constant indices, and pointers loaded from locals by the local, as
+/// unoptimized code reloads "this" before every call.
+static std::string getObjectKey(Value *V, unsigned Depth = 0) {
+  V = V->stripPointerCasts();
+  if (Depth != 4) {
+    if (LoadInst *Load = dyn_cast<LoadInst>(V)) {
+      Value *Slot = Load->getPointerOperand()->stripPointerCasts();
+      if (isa<AllocaInst>(Slot) || isa<GlobalVariable>(Slot))
+        return "*" + getObjectKey(Slot, Depth + 1);
+    }
+    if (GEPOperator *GEP = dyn_cast<GEPOperator>(V))
+      if (GEP->hasAllConstantIndices()) {
+        std::string Key = getObjectKey(GEP->getPointerOperand(), Depth + 1);
+        for (User::op_iterator i = GEP->idx_begin(), e = GEP->idx_end();
+             i != e; ++i)
+          Key += "." + utostr(cast<ConstantInt>(*i)->getZExtValue());
+        return Key;
+      }
+  }
+  return utostr((uint64_t)(uintptr_t)V);
+}
 
-           //std::string sMutexName = v->getNameStr();
-          /* if(    setFunctionUsed.find( std::string("pthread_mutex_init") ) != setFunctionUsed.end()   
-               && setFunctionUsed.find( std::string("pthread_mutex_destroy") ) != setFunctionUsed.end() 
-               && setFunctionUsed.size() == 2 )
-           {
-               std::cout << v->getNameStr() << std::endl;
-           }*/
-        }
-   }
+/// describePointee - A short name for the object V points to, naming a
+/// pointer loaded from a local after the local.
+static std::string describePointee(Value *V) {
+  V = V->stripPointerCasts();
+  if (LoadInst *Load = dyn_cast<LoadInst>(V)) {
+    Value *Slot = Load->getPointerOperand()->stripPointerCasts();
+    if (Slot->hasName()) {
+      StringRef Name = Slot->getName();
+      if (Name.endswith(".addr"))
+        Name = Name.substr(0, Name.size() - 5);
+      return "*" + Name.str();
+    }
+  }
+  if (GEPOperator *GEP = dyn_cast<GEPOperator>(V))
+    if (!GEP->hasName())
+      return "a field of " + describePointee(GEP->getPointerOperand());
+  return describeObject(V);
+}
 
-   //std::set<std::string>::iterator itBegin = setAllFunction.begin();
-   //while( itBegin != setAllFunction.end()  )
-   //{
-   //   std::cout << (*itBegin) << std::endl;
-   //   itBegin ++ ;
-   // }
-  
-    
-    return;
+static std::string describeCallee(Instruction *I) {
+  const Function *Callee = CallSiteIndex::getCallee(I);
+  return Callee ? Callee->getNameStr() : "an indirect call";
 }
 
-void PerfEvo::MySQLBug49491(Function &F)
-{
-  std::string sFunctionName = "sprintf";
-  std::string sPatternOne = "%02X";
-  std::string sPatternTwo = "%02x";
-  for( Function::iterator b = F.begin(), be = F.end() ; b != be ; b ++ )
-  {
-    for( BasicBlock::iterator i = b->begin() , ie = b->end() ; i != ie ; i ++ )
-    {
-      if( CallInst * pCall = dyn_cast<CallInst>(i))
-      {
-        Function * pFunction = pCall->getCalledFunction();
-	if(!pFunction)
-	{
-         continue;
-	}
-
-	std::string fname = pFunction->getName();
-	if( fname == sFunctionName )
-	{
-         //Err << getPathFromInstruction(i) << ":" << getLineFromInstruction(i) << "\n"
-         //    << getSourceLine(i) << "\n";
-         if( ConstantExpr * pCE = dyn_cast<ConstantExpr>( pCall->getArgOperand(1)) )
-         {
-           if( GlobalVariable * pGV = dyn_cast<GlobalVariable>( pCE->getOperand(0) ))
-           {
-           if( pGV->hasInitializer() )
-           {
-             if( ConstantArray * pCA = dyn_cast<ConstantArray>( pGV->getInitializer() ))
-		{
-              std::string sSecondParameter = pCA->getAsString();
-             if( sSecondParameter.length() == 0 || (sSecondParameter.length() - 1) % 4 != 0 )
-             {
-                continue;
-             }
-             while( sSecondParameter.length() > 1 )
-             {
-                 if( sSecondParameter.substr( 0 , 4) != sPatternOne && 
-              sSecondParameter.substr( 0 , 4) != sPatternTwo )
-              {
-                 break;
-              }
-              sSecondParameter = sSecondParameter.substr( 4 , sSecondParameter.length() - 4 );
-             }
+namespace {
+/// LockedProblem - Which lock objects are held on every path to a point.
+/// Bit i stands for lock object i.
+class LockedProblem : public DataflowProblem {
+  // Lock or unlock call -> object number, and whether it locks.
+  const DenseMap<Instruction*, std::pair<unsigned, bool> > &Ops;
+public:
+  LockedProblem(unsigned NumObjects,
+                const DenseMap<Instruction*, std::pair<unsigned, bool> > &O)
+    : DataflowProblem(Forward, Intersection, NumObjects), Ops(O) {}
+  void transfer(Instruction *I, BitVector &V) {
+    if (!isa<CallInst>(I) && !isa<InvokeInst>(I))
+      return;
+    DenseMap<Instruction*, std::pair<unsigned, bool> >::const_iterator Op =
+      Ops.find(I);
+    if (Op == Ops.end())
+      return;
+    if (Op->second.second)
+      V.set(Op->second.first);
+    else
+      V.reset(Op->second.first);
+  }
+};
+
+/// LockContention - Report mutexes locked and unlocked on every iteration
+/// of a loop, and mutexes held across a whole loop that does I/O or
+/// allocates memory.
+class LockContention : public PerfEvoChecker {
+  /// UnderLock - A call in a loop made while some mutexes are held.
+  struct UnderLock {
+    Instruction *Call;
+    BitVector Held;
+  };
+
+  /// LockOp - A lock or unlock call and the number of its object.
+  struct LockOp {
+    Instruction *Call;
+    unsigned Object;
+    bool Lock;
+  };
+
+  // The lock and unlock calls of the function, in program order and by call.
+  std::vector<LockOp> OpList;
+  DenseMap<Instruction*, std::pair<unsigned, bool> > Ops;
+  // The first mention of each lock object, and the objects by getObjectKey,
+  // as every lock and unlock of a field reloads its base in unoptimized
+  // code.
+  std::vector<Value*> Objects;
+  StringMap<unsigned> ObjectNumbers;
+  std::vector<UnderLock> Calls;
+
+  Instruction *findCriticalSection(Instruction *Lock, Loop *L,
+                                   DenseSet<Instruction*> &Inside) const;
+  void reportPerIteration(CheckerContext &C);
+  void reportHeldAcross(CheckerContext &C, Loop *L, const DataflowSolver &S,
+                        BitVector Reported);
+public:
+  void beginFunction(CheckerContext &C) {
+    OpList.clear();
+    Ops.clear();
+    Objects.clear();
+    ObjectNumbers.clear();
+    Calls.clear();
+  }
+  void visit(Instruction *i, CheckerContext &C);
+  void endFunction(CheckerContext &C);
+};
+
+static const char *const LockContentionTriggers[] = {
+  "mutex_lock", "mutex_unlock", "mutex_enter", "mutex_exit", 0
+};
+static RegisterChecker<LockContention>
+RegLockContention("LockContention", FunctionScope, NeedsLoopInfo,
+                  LockContentionTriggers);
+}
 
-             if( sSecondParameter.length() == 1 )
-             {
-               std::string strPath;
-               unsigned uLineNo=0;
-               assert(getPathAndLineNo(i, strPath, uLineNo) && "No DebugInfo");
+void LockContention::visit(Instruction *i, CheckerContext &C) {
+  CallSite CS(i);
+  if (!CS.getInstruction() || CS.arg_size() == 0)
+    return;
+  const Function *Callee = CallSiteIndex::getCallee(i);
+  if (!Callee)
+    return;
+  StringRef Name = Callee->getName();
+  bool Lock;
+  if (Name.find("mutex_unlock") != StringRef::npos ||
+      Name.find("mutex_exit") != StringRef::npos)
+    Lock = false;
+  else if (Name.find("mutex_lock") != StringRef::npos ||
+           Name.find("mutex_enter") != StringRef::npos)
+    Lock = true;
+  else
+    return;
 
-               Err << strPath << ":" << uLineNo << "\n"
-                   << getSourceLine(strPath, uLineNo) << "\n";
-             }
+  Value *Object = CS.getArgument(0)->stripPointerCasts();
+  unsigned Number = ObjectNumbers.GetOrCreateValue(getObjectKey(Object),
+                                                   Objects.size()).getValue();
+  if (Number == Objects.size())
+    Objects.push_back(Object);
+  LockOp Op = { i, Number, Lock };
+  OpList.push_back(Op);
+  Ops[i] = std::make_pair(Op.Object, Lock);
+}
 
-		}
-           }
-           }
-         }
-	}
+/// findCriticalSection - Add to Inside the calls on the paths from Lock
+/// through L up to an unlock of its object, not going round the loop, and
+/// return the first such unlock, or null if there is none.
+Instruction *
+LockContention::findCriticalSection(Instruction *Lock, Loop *L,
+                                    DenseSet<Instruction*> &Inside) const {
+  unsigned Object = Ops.find(Lock)->second.first;
+  Instruction *Unlock = 0;
+  DenseSet<BasicBlock*> Visited;
+  std::vector<BasicBlock::iterator> Worklist;
+  Worklist.push_back(llvm::next(BasicBlock::iterator(Lock)));
+  while (!Worklist.empty()) {
+    BasicBlock::iterator I = Worklist.back();
+    Worklist.pop_back();
+    BasicBlock *BB = I->getParent();
+    bool Released = false;
+    for (BasicBlock::iterator E = BB->end(); I != E && !Released; ++I) {
+      if (!isa<CallInst>(I) && !isa<InvokeInst>(I))
+        continue;
+      DenseMap<Instruction*, std::pair<unsigned, bool> >::const_iterator Op =
+        Ops.find(I);
+      if (Op == Ops.end()) {
+        Inside.insert(I);
+      } else if (Op->second.first == Object && !Op->second.second) {
+        if (!Unlock)
+          Unlock = I;
+        Released = true;
       }
     }
+    if (Released)
+      continue;
+    for (succ_iterator s = succ_begin(BB), se = succ_end(BB); s != se; ++s)
+      if (*s != L->getHeader() && L->contains(*s) &&
+          Visited.insert(*s).second)
+        Worklist.push_back((*s)->begin());
   }
+  return Unlock;
 }
 
+/// reportPerIteration - Report locks in a loop that are released in the same
+/// iteration, with the calls made between the lock and the unlock.
+void LockContention::reportPerIteration(CheckerContext &C) {
+  for (unsigned i = 0, e = OpList.size(); i != e; ++i) {
+    if (!OpList[i].Lock)
+      continue;
+    Loop *L = C.LI->getLoopFor(OpList[i].Call->getParent());
+    if (!L)
+      continue;
 
+    DenseSet<Instruction*> Inside;
+    Instruction *Unlock = findCriticalSection(OpList[i].Call, L, Inside);
+    if (!Unlock)
+      continue;
 
-void PerfEvo::MySQLBug38769(Function &F)
-{
-    //if( F.getName().find( "restore_table_data" ) == std::string::npos )
-    //{
-    //    return;
-    //}
-     
-    //std::cout << F.getNameStr() << std::string::npos;
+    Finding R;
+    R.LoopDepth = L->getLoopDepth();
+    R.Message = describePointee(Objects[OpList[i].Object]) +
+                " is locked and unlocked on every iteration";
+    R.Related.push_back(C.getLoc(Unlock, "unlocked here"));
+    // In program order, each call once.
+    for (Function::iterator b = C.F.begin(), be = C.F.end(); b != be; ++b) {
+      if (!L->contains(b))
+        continue;
+      for (BasicBlock::iterator k = b->begin(), ke = b->end(); k != ke; ++k)
+        if (Inside.count(k))
+          R.Related.push_back(C.getLoc(k, "calls " + describeCallee(k) +
+                                       " under the lock"));
+    }
+    C.report(OpList[i].Call, R);
+  }
+}
 
-    TypePrinting Printer;
-    std::vector<const Type *> NumberedTypes;
-    AddModuleTypesToPrinter( Printer , NumberedTypes , _M );
+/// reportHeldAcross - Report the objects held on entry to every iteration
+/// of L that L neither locks nor unlocks, if L does I/O or allocates while
+/// holding them.  Objects in Reported were reported for an outer loop.
+void LockContention::reportHeldAcross(CheckerContext &C, Loop *L,
+                                      const DataflowSolver &S,
+                                      BitVector Reported) {
+  BitVector Held = S.getBlockBegin(L->getHeader());
+  for (unsigned i = 0, e = OpList.size(); i != e; ++i)
+    if (L->contains(OpList[i].Call->getParent()))
+      Held.reset(OpList[i].Object);
+
+  for (int o = Held.find_first(); o != -1; o = Held.find_next(o)) {
+    if (Reported.test(o))
+      continue;
 
-    LoopInfo *LI = &getAnalysis<LoopInfo>();
+    Finding R;
+    Instruction *First = 0;
+    std::string Name;
+    for (unsigned k = 0, ke = Calls.size(); k != ke; ++k) {
+      Instruction *Call = Calls[k].Call;
+      if (!Calls[k].Held.test(o) || !L->contains(Call->getParent()))
+        continue;
+      const Function *Callee = CallSiteIndex::getCallee(Call);
+      if (!Callee || !isBlockingCall(Callee->getName()))
+        continue;
+      if (!First) {
+        First = Call;
+        Name = Callee->getName();
+      } else {
+        R.Related.push_back(C.getLoc(Call, "calls " + Callee->getNameStr() +
+                                     " under the lock"));
+      }
+    }
+    if (!First)
+      continue;
 
-    for( Function::iterator b = F.begin(), be = F.end() ; b != be; ++ b )
-    {
-        for( BasicBlock::iterator i = b->begin() , ie = b->end() ; i != ie ; ++ i)
-	{
-            if( GetElementPtrInst * pGet = dyn_cast<GetElementPtrInst>(i))
-	    {
-	       
-                 std::string sResult;
-                 raw_string_ostream rstring(sResult);
-                 Printer.print( pGet->getOperand(0)->getType() , rstring );
-                 std::string sGetType = rstring.str();
-                     
-	         if( sGetType.find( "_info" ) != std::string::npos && sGetType.find("struct") != std::string::npos  )
-	         {
-                      //std::cout << sGetType << std::endl;   
-		      if(pGet->getNumOperands() != 5 )
-		      {
-                          continue;
-		      }
-
-		      if( ConstantInt * pConstant = dyn_cast<ConstantInt>( pGet->getOperand(1) ) )
-		      {
-                          if( !pConstant->equalsInt(0) )
-			  {
-                              continue;
-			  }
-		      }
-		      else
-		      {
-		          continue;
-		      }
-
-		      if( ConstantInt * pConstant = dyn_cast<ConstantInt>( pGet->getOperand(2) ) )
-		      {
-                          if( !pConstant->equalsInt(0) )
-			  {
-                             continue;
-			  }
-		      }
-		      else
-		      {
-		          continue;
-		      }
-
-
-                      if( ConstantInt * pConstant = dyn_cast<ConstantInt>( pGet->getOperand(3) ) )
-		      {
-                          if( !pConstant->equalsInt(3) )
-			  {
-                             continue;
-			  }
-		      }
-		      else
-		      {
-		          continue;
-		      }
-
-		      if( Instruction * pInst = dyn_cast<Instruction>( pGet->getOperand(4) ) )
-		      {
-                         if( !pInst->getType()->isIntegerTy() )
-			 {
-                             continue;
-			 }
-		      }
-		      else
-		      {
-                          continue;
-		      }
-
-		      //pGet->dump();
-		      
-		      if( LI->getLoopDepth( i->getParent() ) > 0 )
-		      {
-                          Loop * pLoop = LI->getLoopFor( i->getParent() );
-			  BasicBlock * pBlock = getLoopHeader( *LI , pLoop );
-                          //pBlock->dump();
-			  for( BasicBlock::iterator iloop = pBlock->begin(), ieloop = pBlock->end() ; iloop != ieloop ; iloop ++  )
-			  {
-                              if( BranchInst * pIndirect = dyn_cast<BranchInst>( iloop ) )
-			      {
-                                 //pIndirect->dump();
-				 //std::cout << pIndirect->isConditional() << std::endl;
-				 //pIndirect->getCondition()->dump();
-				 if( pIndirect->isConditional() )
-				 {
-                                     if( ICmpInst * pICmp = dyn_cast<ICmpInst>( pIndirect->getCondition() ) )
-				     {
-				         //pICmp->dump();
-                                         if( isa<ConstantInt>( pICmp->getOperand(0) ) && isa<Instruction>( pICmp->getOperand(1)) )
-					 {
-                                             std::string strPath;
-					     unsigned uLineNo;
-			                     getPathAndLineNo( i , strPath , uLineNo );
-                                             if( strPath == "" )
-					     {
-					         getPathAndLineNo( iloop , strPath , uLineNo );
-						 std::cout << strPath << " : " << uLineNo << std::endl;
-						 std::cout << "\t" << getSourceLine( strPath , uLineNo ) << std::endl;
-					         //pBlock->dump();
-                                                 std::cout << F.getNameStr() << std::endl;
-						 i->dump();
-					     }
-					     else
-					     {
-					         std::cout << strPath << ":" << uLineNo << std::endl;
-						 std::cout << "\t"    << getSourceLine(strPath, uLineNo) << std::endl;
-					     }
-
-					     std::cout << "====================" << std::endl;
-					 }
-					 else if( isa<Instruction>( pICmp->getOperand(0)) && isa<ConstantInt>( pICmp->getOperand(1)) )
-					 {
-                                              std::string strPath;
-					      unsigned uLineNo;
-					      getPathAndLineNo( i , strPath , uLineNo );
-					      if( strPath == "" )
-					      {	
-					           getPathAndLineNo( iloop , strPath , uLineNo );
-						   std::cout << strPath << " : " << uLineNo << std::endl;
-						   std::cout << "\t" << getSourceLine( strPath , uLineNo )  << std::endl;
-					           //pBlock->dump();
-					           std::cout << F.getNameStr() << std::endl;
-						   i->dump();
-					      }
-					      else
-					      {
-					           std::cout << strPath << " : " << uLineNo << std::endl;
-						   std::cout << "\t" << getSourceLine(strPath, uLineNo) << std::endl;
-				              }
-
-					      std::cout << "====================" << std::endl;
-
-					 }
-
-
-				     }
-				 }
-			      }
-			  }
-			  //pBlock->dump();
-		      }
-	         }
-                     
-                 //std::string strPath;
-                 //unsigned uLineNo;
-                 //getPathAndLineNo( i, strPath, uLineNo);
-                 //std::cout << strPath << ":" << uLineNo << std::endl;
-                 //std::cout << "\t"    << getSourceLine(strPath, uLineNo) << std::endl;
-
-	    }
-       }
-   }
+    R.LoopDepth = L->getLoopDepth();
+    R.Message = describePointee(Objects[o]) + " is held across a loop that "
+                "calls " + Name;
+    if (!R.Related.empty())
+      R.Message += " and " + utostr(R.Related.size()) + " more";
+    for (unsigned i = 0, e = OpList.size(); i != e; ++i)
+      if (OpList[i].Lock && OpList[i].Object == (unsigned)o)
+        R.Related.push_back(C.getLoc(OpList[i].Call, "locked here"));
+    C.report(First, R);
+    Reported.set(o);
+  }
 
-  
+  for (Loop::iterator Sub = L->begin(), SE = L->end(); Sub != SE; ++Sub)
+    reportHeldAcross(C, *Sub, S, Reported);
 }
 
+void LockContention::endFunction(CheckerContext &C) {
+  if (OpList.empty() || C.LI->begin() == C.LI->end())
+    return;
 
-void PerfEvo::MySQLBug38824(Function &F) {
-}
+  LockedProblem P(Objects.size(), Ops);
+  DataflowSolver S(P);
+  if (!S.solve(C.F))
+    return;
 
-bool PerfEvo::JumpBackToLoop( LoopInfo &li , Loop  *l , BasicBlock * pJumpInst )
-{
-   for( Loop::iterator b = l->begin() , be = l->end() ;b != be ; ++ b  )
-   {
-       //if( b == pJumpInst )
-       //{
-       //   return true;
-       //}
-   }
+  // Remember what is held at each call in a loop.
+  BitVector Held;
+  for (Function::iterator b = C.F.begin(), be = C.F.end(); b != be; ++b) {
+    if (!C.LI->getLoopDepth(b))
+      continue;
+    Held = S.getBlockBegin(b);
+    for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) {
+      if ((isa<CallInst>(i) || isa<InvokeInst>(i)) && !Ops.count(i) &&
+          Held.any()) {
+        Calls.push_back(UnderLock());
+        Calls.back().Call = i;
+        Calls.back().Held = Held;
+      }
+      P.transfer(i, Held);
+    }
+  }
 
-   return false;
+  reportPerIteration(C);
+  for (BasicLoopInfo::iterator L = C.LI->begin(), LE = C.LI->end(); L != LE;
+       ++L)
+    reportHeldAcross(C, *L, S, BitVector(Objects.size()));
 }
 
+/// isReallocFunction - Whether Name resizes a block like realloc.  Growing a
+/// block in a loop is AppendWithoutReserve's finding, not LoopAllocation's.
+static bool isReallocFunction(StringRef Name) {
+  return Name == "realloc" || Name == "my_realloc" || Name == "moz_xrealloc";
+}
 
+static cl::list<std::string> Allocators("perfAllocators",
+       cl::desc("More allocation functions for LoopAllocation, as <name> or "
+                "<name>:<i> with i the index of the size argument"),
+       cl::CommaSeparated, cl::value_desc("name[:i]"));
+
+static cl::list<std::string> Deallocators("perfDeallocators",
+       cl::desc("More deallocation functions for LoopAllocation"),
+       cl::CommaSeparated, cl::value_desc("name"));
+
+namespace {
+/// AllocFunction - How a function allocates or frees memory.
+struct AllocFunction {
+  enum AllocKind { Alloc, Free };
+  AllocKind Kind;
+  /// SizeArg, CountArg - The arguments whose product is the allocated size,
+  /// -1 if not used.
+  int SizeArg, CountArg;
+  /// Display - How the function is named in findings, null for its name.
+  const char *Display;
+};
 
-void PerfEvo::MySQLBug14637(Function &F) 
-{
-   //if( F.getName().find("my_strnncollsp_latin1_de") == std::string::npos )
-   //{
-   //    return;
-   //}
+struct KnownAllocFunction {
+  const char *Name;
+  AllocFunction F;
+};
 
-   const LoopInfo *LI = &getAnalysis<LoopInfo>();
+static const KnownAllocFunction KnownAllocFunctions[] = {
+  { "malloc",      { AllocFunction::Alloc, 0, -1, 0 } },
+  { "calloc",      { AllocFunction::Alloc, 1, 0, 0 } },
+  { "realloc",     { AllocFunction::Alloc, 1, -1, 0 } },
+  { "valloc",      { AllocFunction::Alloc, 0, -1, 0 } },
+  { "_Znwj",       { AllocFunction::Alloc, 0, -1, "operator new" } },
+  { "_Znwm",       { AllocFunction::Alloc, 0, -1, "operator new" } },
+  { "_Znaj",       { AllocFunction::Alloc, 0, -1, "operator new[]" } },
+  { "_Znam",       { AllocFunction::Alloc, 0, -1, "operator new[]" } },
+  { "my_malloc",   { AllocFunction::Alloc, 0, -1, 0 } },
+  { "apr_palloc",  { AllocFunction::Alloc, 1, -1, 0 } },
+  { "apr_pcalloc", { AllocFunction::Alloc, 1, -1, 0 } },
+  { "moz_xmalloc", { AllocFunction::Alloc, 0, -1, 0 } },
+  { "moz_xrealloc", { AllocFunction::Alloc, 1, -1, 0 } },
+  { "free",        { AllocFunction::Free, -1, -1, 0 } },
+  { "_ZdlPv",      { AllocFunction::Free, -1, -1, "operator delete" } },
+  { "_ZdaPv",      { AllocFunction::Free, -1, -1, "operator delete[]" } },
+  { "my_free",     { AllocFunction::Free, -1, -1, 0 } },
+  { "moz_free",    { AllocFunction::Free, -1, -1, 0 } },
+  { 0,             { AllocFunction::Free, -1, -1, 0 } }
+};
 
-   for( Function::iterator b = F.begin() , be = F.end() ; b != be ; ++ b )
+/// LoopAllocation - Report heap allocations and frees on every iteration of
+/// a loop, telling whether the size is constant, loop invariant or changes,
+/// and pointing out blocks allocated and freed in the same iteration.
+class LoopAllocation : public PerfEvoChecker {
+  struct AllocCall {
+    Instruction *Call;
+    const AllocFunction *F;
+    Loop *L;
+  };
+
+  StringMap<AllocFunction> Functions;
+  // Callee -> its entry in Functions, or null.
+  DenseMap<const Function*, const AllocFunction*> Callees;
+  // The calls of the current function in loops, in program order.
+  std::vector<AllocCall> Calls;
+
+  const AllocFunction *classify(const Function *Callee);
+  std::string getName(const AllocCall &A) const;
+  bool resizesEachIteration(const AllocCall &A) const;
+public:
+  LoopAllocation();
+  void getInterest(CheckerInterest &I) const {
+    I.Opcodes.push_back(Instruction::Call);
+    I.Opcodes.push_back(Instruction::Invoke);
+  }
+  void beginFunction(CheckerContext &C) { Calls.clear(); }
+  void visit(Instruction *i, CheckerContext &C);
+  void endFunction(CheckerContext &C);
+};
+
+static RegisterChecker<LoopAllocation>
+RegLoopAllocation("LoopAllocation", FunctionScope, NeedsLoopInfo);
+}
+
+LoopAllocation::LoopAllocation() {
+  for (const KnownAllocFunction *K = KnownAllocFunctions; K->Name; ++K)
+    Functions[K->Name] = K->F;
+
+  for (unsigned i = 0, e = Allocators.size(); i != e; ++i) {
+    std::pair<StringRef, StringRef> Spec = StringRef(Allocators[i]).split(':');
+    AllocFunction F = { AllocFunction::Alloc, 0, -1, 0 };
+    if (!Spec.second.empty() && Spec.second.getAsInteger(10, F.SizeArg))
+      report_fatal_error("-perfAllocators: bad size argument index in " +
+                         Allocators[i]);
+    Functions[Spec.first] = F;
+  }
+  for (unsigned i = 0, e = Deallocators.size(); i != e; ++i) {
+    AllocFunction F = { AllocFunction::Free, -1, -1, 0 };
+    Functions[Deallocators[i]] = F;
+  }
+}
+
+const AllocFunction *LoopAllocation::classify(const Function *Callee) {
+  DenseMap<const Function*, const AllocFunction*>::iterator I =
+    Callees.find(Callee);
+  if (I != Callees.end())
+    return I->second;
+  StringMap<AllocFunction>::iterator F = Functions.find(Callee->getName());
+  return Callees[Callee] = F == Functions.end() ? 0 : &F->second;
+}
+
+std::string LoopAllocation::getName(const AllocCall &A) const {
+  if (A.F->Display)
+    return A.F->Display;
+  return CallSiteIndex::getCallee(A.Call)->getNameStr();
+}
+
+void LoopAllocation::visit(Instruction *i, CheckerContext &C) {
+  Loop *L = C.LI->getLoopFor(i->getParent());
+  if (!L)
+    return;
+  const Function *Callee = CallSiteIndex::getCallee(i);
+  if (!Callee)
+    return;
+  if (const AllocFunction *F = classify(Callee)) {
+    AllocCall A = { i, F, L };
+    Calls.push_back(A);
+  }
+}
+
+/// isInvariantIn - Whether V has the same value on every iteration of L.
+/// Besides values computed outside L, this accepts loads of locals that L
+/// does not store to, and arithmetic on such values, which is what sizes
+/// look like in unoptimized code.
+static bool isInvariantIn(Value *V, Loop *L, unsigned Depth = 0) {
+  if (L->isLoopInvariant(V))
+    return true;
+  if (Depth == 4)
+    return false;
+
+  if (LoadInst *Load = dyn_cast<LoadInst>(V)) {
+    AllocaInst *Slot = dyn_cast<AllocaInst>(Load->getPointerOperand());
+    if (!Slot)
+      return false;
+    for (Value::use_iterator u = Slot->use_begin(), ue = Slot->use_end();
+         u != ue; ++u)
+      if (Instruction *I = dyn_cast<Instruction>(*u))
+        if (!isa<LoadInst>(I) && L->contains(I->getParent()))
+          return false;
+    return true;
+  }
+
+  if (!isa<BinaryOperator>(V) && !isa<CastInst>(V))
+    return false;
+  User *U = cast<User>(V);
+  for (unsigned i = 0, e = U->getNumOperands(); i != e; ++i)
+    if (!isInvariantIn(U->getOperand(i), L, Depth + 1))
+      return false;
+  return true;
+}
+
+/// describeSize - Tell how the size allocated by Call changes across the
+/// iterations of L.
+static std::string describeSize(Instruction *Call, const AllocFunction &F,
+                                Loop *L) {
+  CallSite CS(Call);
+  Value *Size = 0, *Count = 0;
+  if (F.SizeArg >= 0 && (unsigned)F.SizeArg < CS.arg_size())
+    Size = CS.getArgument(F.SizeArg);
+  if (F.CountArg >= 0 && (unsigned)F.CountArg < CS.arg_size())
+    Count = CS.getArgument(F.CountArg);
+  if (!Size)
+    return "";
+
+  ConstantInt *ConstSize = dyn_cast<ConstantInt>(Size);
+  ConstantInt *ConstCount = Count ? dyn_cast<ConstantInt>(Count) : 0;
+  if (ConstSize && (!Count || ConstCount)) {
+    uint64_t N = ConstSize->getValue().getLimitedValue();
+    if (ConstCount)
+      N *= ConstCount->getValue().getLimitedValue();
+    return " of a constant size (" + utostr(N) + " bytes)";
+  }
+  if (isInvariantIn(Size, L) && (!Count || isInvariantIn(Count, L)))
+    return " of a loop-invariant size";
+  return " of a size that changes with the iteration";
+}
+
+/// freesResultOf - Whether the free call Free is passed the block returned
+/// by Alloc, directly or through a local Alloc is stored to in L.
+static bool freesResultOf(Instruction *Free, Instruction *Alloc, Loop *L) {
+  CallSite CS(Free);
+  if (CS.arg_size() == 0)
+    return false;
+  Value *Ptr = CS.getArgument(0)->stripPointerCasts();
+  if (Ptr == Alloc)
+    return true;
+  LoadInst *Load = dyn_cast<LoadInst>(Ptr);
+  if (!Load)
+    return false;
+
+  Value *Slot = Load->getPointerOperand()->stripPointerCasts();
+  SmallVector<Value*, 4> Worklist;
+  Worklist.push_back(Alloc);
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    for (Value::use_iterator u = V->use_begin(), ue = V->use_end(); u != ue;
+         ++u) {
+      if (CastInst *Cast = dyn_cast<CastInst>(*u))
+        Worklist.push_back(Cast);
+      else if (StoreInst *Store = dyn_cast<StoreInst>(*u))
+        if (Store->getOperand(0) == V &&
+            Store->getPointerOperand()->stripPointerCasts() == Slot &&
+            L->contains(Store->getParent()))
+          return true;
+    }
+  }
+  return false;
+}
+
+/// resizesEachIteration - Whether A is a realloc to a size that changes with
+/// the iteration, which AppendWithoutReserve reports.
+bool LoopAllocation::resizesEachIteration(const AllocCall &A) const {
+  CallSite CS(A.Call);
+  const Function *Callee = CallSiteIndex::getCallee(A.Call);
+  if (!isReallocFunction(Callee->getName()) || A.F->SizeArg < 0 ||
+      (unsigned)A.F->SizeArg >= CS.arg_size())
+    return false;
+  return !isInvariantIn(CS.getArgument(A.F->SizeArg), A.L);
+}
+
+void LoopAllocation::endFunction(CheckerContext &C) {
+  // The free paired with each allocation, and whether each call was paired.
+  std::vector<int> FreedBy(Calls.size(), -1);
+  std::vector<bool> Paired(Calls.size());
+  // Reallocations that grow the block are left out entirely, so one call
+  // makes one finding.
+  std::vector<bool> Resizes(Calls.size());
+  for (unsigned a = 0, e = Calls.size(); a != e; ++a)
+    Resizes[a] = resizesEachIteration(Calls[a]);
+  for (unsigned a = 0, e = Calls.size(); a != e; ++a) {
+    if (Calls[a].F->Kind != AllocFunction::Alloc || Resizes[a])
+      continue;
+    for (unsigned f = 0; f != e; ++f)
+      if (Calls[f].F->Kind == AllocFunction::Free && !Paired[f] &&
+          Calls[f].L == Calls[a].L &&
+          freesResultOf(Calls[f].Call, Calls[a].Call, Calls[a].L)) {
+        FreedBy[a] = f;
+        Paired[a] = Paired[f] = true;
+        break;
+      }
+  }
+
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i) {
+    const AllocCall &A = Calls[i];
+    if (Resizes[i])
+      continue;
+    Finding R;
+    R.LoopDepth = A.L->getLoopDepth();
+    if (FreedBy[i] != -1) {
+      const AllocCall &F = Calls[FreedBy[i]];
+      R.Message = getName(A) + describeSize(A.Call, *A.F, A.L) +
+                  " freed with " + getName(F) + " in the same iteration; "
+                  "reuse the block or allocate from an arena";
+      R.Related.push_back(C.getLoc(F.Call, "freed here"));
+    } else if (Paired[i]) {
+      continue;
+    } else if (A.F->Kind == AllocFunction::Alloc) {
+      R.Message = getName(A) + describeSize(A.Call, *A.F, A.L) +
+                  " on every iteration";
+    } else {
+      R.Message = getName(A) + " on every iteration";
+    }
+    C.report(A.Call, R);
+  }
+}
+
+namespace {
+/// GrowthFunction - How a function grows a container or reserves room in it.
+struct GrowthFunction {
+  enum GrowthKind { Grow, Reserve, Realloc };
+  GrowthKind Kind;
+  /// Display - How the function is named in findings.
+  const char *Display;
+  /// Unit - What the container holds, and the call that reserves room for it.
+  const char *Unit;
+  const char *ReserveName;
+  /// OneAtATime - Whether every call adds exactly one character or element.
+  bool OneAtATime;
+};
+
+static const GrowthFunction GrowthFunctions[] = {
+  { GrowthFunction::Grow, "nsAString::Append", "characters", "SetCapacity",
+    false },
+  { GrowthFunction::Reserve, "nsAString::SetCapacity", "", "", false },
+  { GrowthFunction::Grow, "std::string::append", "characters", "reserve",
+    false },
+  { GrowthFunction::Grow, "std::string::operator+=", "characters", "reserve",
+    false },
+  { GrowthFunction::Grow, "std::string::push_back", "characters", "reserve",
+    true },
+  { GrowthFunction::Reserve, "std::string::reserve", "", "", false },
+  { GrowthFunction::Grow, "std::vector::push_back", "elements", "reserve",
+    true },
+  { GrowthFunction::Grow, "std::vector::emplace_back", "elements", "reserve",
+    true },
+  { GrowthFunction::Reserve, "std::vector::reserve", "", "", false },
+  { GrowthFunction::Realloc, "realloc", "bytes", "", false }
+};
+
+enum {
+  NSAppend, NSSetCapacity, StringAppend, StringPlusEqual, StringPushBack,
+  StringReserve, VectorPushBack, VectorEmplaceBack, VectorReserve, Realloc
+};
+
+/// AppendWithoutReserve - Report strings and vectors grown by appends in a
+/// loop that has no SetCapacity or reserve of the same object before it, and
+/// blocks grown by realloc to a larger size on every iteration.  Each growth
+/// may copy everything appended so far.
+class AppendWithoutReserve : public PerfEvoChecker {
+  struct GrowthCall {
+    Instruction *Call;
+    const GrowthFunction *F;
+    Loop *L;
+    std::string Object;
+  };
+
+  // Callee -> its entry in GrowthFunctions, or null.
+  DenseMap<const Function*, const GrowthFunction*> Callees;
+  // The growth calls of the current function in loops, and its reserve
+  // calls anywhere, in program order.
+  std::vector<GrowthCall> Calls;
+  std::vector<GrowthCall> Reserves;
+
+  const GrowthFunction *classify(const Function *Callee);
+  bool isReservedBefore(const GrowthCall &G,
+                        DominatorTreeBase<BasicBlock> &DT) const;
+public:
+  void beginFunction(CheckerContext &C) {
+    Calls.clear();
+    Reserves.clear();
+  }
+  void visit(Instruction *i, CheckerContext &C);
+  void endFunction(CheckerContext &C);
+};
+
+static const char *const AppendWithoutReserveTriggers[] = {
+  "Append", "SetCapacity", "append", "pLE", "push_back", "emplace_back",
+  "reserve", "realloc", 0
+};
+static RegisterChecker<AppendWithoutReserve>
+RegAppendWithoutReserve("AppendWithoutReserve", FunctionScope, NeedsLoopInfo,
+                        AppendWithoutReserveTriggers);
+}
+
+/// hasMember - Whether the mangled Name names the member Encoded, given as
+/// mangled, e.g. "6Append" in "_ZN18nsAString_internal6AppendEPKtj".  Longer
+/// names that end the same, like "16AppendLiteral...", do not count.
+static bool hasMember(StringRef Name, StringRef Encoded) {
+  for (size_t Pos = Name.find(Encoded); Pos != StringRef::npos;
+       Pos = Name.find(Encoded, Pos + 1)) {
+    size_t End = Pos + Encoded.size();
+    bool DigitBefore = Pos != 0 && Name[Pos - 1] >= '0' && Name[Pos - 1] <= '9';
+    if (!DigitBefore && End < Name.size() &&
+        (Name[End] == 'E' || Name[End] == 'I'))
+      return true;
+  }
+  return false;
+}
+
+const GrowthFunction *AppendWithoutReserve::classify(const Function *Callee) {
+  DenseMap<const Function*, const GrowthFunction*>::iterator I =
+    Callees.find(Callee);
+  if (I != Callees.end())
+    return I->second;
+
+  StringRef Name = Callee->getName();
+  int Index = -1;
+  if (isReallocFunction(Name)) {
+    Index = Realloc;
+  } else if (!Name.startswith("_Z")) {
+    // Not a C++ member.
+  } else if (Name.startswith("_ZNSt6vector")) {
+    if (hasMember(Name, "9push_back"))
+      Index = VectorPushBack;
+    else if (hasMember(Name, "12emplace_back"))
+      Index = VectorEmplaceBack;
+    else if (hasMember(Name, "7reserve"))
+      Index = VectorReserve;
+  } else if (Name.startswith("_ZNSs") || Name.startswith("_ZNSbIw") ||
+             Name.find("basic_string") != StringRef::npos) {
+    if (hasMember(Name, "6append"))
+      Index = StringAppend;
+    else if (Name.find("SspLE") != StringRef::npos ||
+             Name.find("EEpLE") != StringRef::npos)
+      Index = StringPlusEqual;
+    else if (hasMember(Name, "9push_back"))
+      Index = StringPushBack;
+    else if (hasMember(Name, "7reserve"))
+      Index = StringReserve;
+  } else if (Name.find("String") != StringRef::npos ||
+             Name.find("Substring") != StringRef::npos) {
+    if (hasMember(Name, "6Append"))
+      Index = NSAppend;
+    else if (hasMember(Name, "11SetCapacity"))
+      Index = NSSetCapacity;
+  }
+  return Callees[Callee] = Index == -1 ? 0 : &GrowthFunctions[Index];
+}
+
+void AppendWithoutReserve::visit(Instruction *i, CheckerContext &C) {
+  CallSite CS(i);
+  const Function *Callee = CallSiteIndex::getCallee(i);
+  if (!Callee || CS.arg_size() == 0)
+    return;
+  const GrowthFunction *F = classify(Callee);
+  if (!F)
+    return;
+
+  Loop *L = C.LI->getLoopFor(i->getParent());
+  GrowthCall G = { i, F, L, getObjectKey(CS.getArgument(0)) };
+  if (F->Kind == GrowthFunction::Reserve)
+    Reserves.push_back(G);
+  else if (L)
+    Calls.push_back(G);
+}
+
+/// getAppendedLength - The number of characters or elements one call Call of
+/// F adds, or zero if it is not known.
+static uint64_t getAppendedLength(Instruction *Call, const GrowthFunction &F) {
+  if (F.OneAtATime)
+    return 1;
+  CallSite CS(Call);
+  if (CS.arg_size() < 2)
+    return 0;
+  // Append(data, length) and append(data, n), where Append's length
+  // defaults to -1 for "up to the terminator".
+  if (CS.arg_size() > 2)
+    if (ConstantInt *N = dyn_cast<ConstantInt>(CS.getArgument(2)))
+      if (!N->isAllOnesValue())
+        return N->getZExtValue();
+
+  Value *Data = CS.getArgument(1)->stripPointerCasts();
+  if (isa<ConstantInt>(Data))
+    return 1;
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(Data))
+    if (GV->isConstant() && GV->hasInitializer())
+      if (ConstantArray *CA = dyn_cast<ConstantArray>(GV->getInitializer()))
+        return CA->getNumOperands() ? CA->getNumOperands() - 1 : 0;
+  return 0;
+}
+
+/// isReservedBefore - Whether a reserve call of G's object outside G's loop
+/// dominates the loop.
+bool AppendWithoutReserve::isReservedBefore(
+    const GrowthCall &G, DominatorTreeBase<BasicBlock> &DT) const {
+  BasicBlock *Header = G.L->getHeader();
+  for (unsigned i = 0, e = Reserves.size(); i != e; ++i) {
+    BasicBlock *BB = Reserves[i].Call->getParent();
+    if (Reserves[i].Object == G.Object && !G.L->contains(BB) &&
+        DT.dominates(BB, Header))
+      return true;
+  }
+  return false;
+}
+
+void AppendWithoutReserve::endFunction(CheckerContext &C) {
+  if (Calls.empty())
+    return;
+  DominatorTreeBase<BasicBlock> DT(false);
+  if (!Reserves.empty())
+    DT.recalculate(C.F);
+
+  // Growth calls of the same object in the same loop make one finding, at
+  // the first of them.
+  std::vector<bool> Done(Calls.size());
+  for (unsigned i = 0, e = Calls.size(); i != e; ++i) {
+    const GrowthCall &G = Calls[i];
+    if (Done[i])
+      continue;
+    Finding R;
+    R.LoopDepth = G.L->getLoopDepth();
+    uint64_t Trips = getConstantTripCount(G.L, C.SE);
+
+    if (G.F->Kind == GrowthFunction::Realloc) {
+      CallSite CS(G.Call);
+      if (CS.arg_size() < 2 || isInvariantIn(CS.getArgument(1), G.L))
+        continue;
+      R.Message = describeCallee(G.Call) + " of " +
+                  describePointee(CS.getArgument(0)) +
+                  " to a size that changes on every iteration";
+      if (Trips)
+        R.Message += ", " + utostr(Trips) + " times";
+      R.Message += "; grow the block geometrically or size it before the "
+                   "loop";
+      C.report(G.Call, R);
+      continue;
+    }
+
+    if (!Reserves.empty() && isReservedBefore(G, DT))
+      continue;
+    uint64_t PerIteration = getAppendedLength(G.Call, *G.F);
+    unsigned NumCalls = 1;
+    for (unsigned j = i + 1; j != e; ++j)
+      if (!Done[j] && Calls[j].L == G.L && Calls[j].Object == G.Object &&
+          Calls[j].F->Kind == GrowthFunction::Grow) {
+        Done[j] = true;
+        ++NumCalls;
+        uint64_t N = getAppendedLength(Calls[j].Call, *Calls[j].F);
+        PerIteration = PerIteration && N ? PerIteration + N : 0;
+        R.Related.push_back(C.getLoc(Calls[j].Call, "also grows it here"));
+      }
+
+    R.Message = std::string(G.F->Display) + " on " +
+                describePointee(CallSite(G.Call).getArgument(0)) +
+                " in a loop with no " + G.F->ReserveName + " before it";
+    if (Trips && PerIteration)
+      R.Message += "; about " + utostr(Trips * PerIteration) + " " +
+                   G.F->Unit + " after " + utostr(Trips) + " iterations";
+    else if (Trips)
+      R.Message += "; " + utostr(Trips * NumCalls) + " appends over " +
+                   utostr(Trips) + " iterations";
+    C.report(G.Call, R);
+  }
+}
+
+namespace {
+class MySQLBug49491 : public PerfEvoChecker {
+public:
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static const char *const MySQLBug49491Triggers[] = {
+  "sprintf", 0
+};
+static RegisterChecker<MySQLBug49491>
+RegMySQLBug49491("MySQLBug49491", FunctionScope, NoAnalyses,
+                 MySQLBug49491Triggers);
+}
+
+void MySQLBug49491::visit(Instruction *i, CheckerContext &C)
+{
+  std::string sFunctionName = "sprintf";
+  std::string sPatternOne = "%02X";
+  std::string sPatternTwo = "%02x";
+
+  CallInst * pCall = dyn_cast<CallInst>(i);
+  const Function *Callee = pCall ? CallSiteIndex::getCallee(pCall) : 0;
+  if( !Callee || Callee->getName() != sFunctionName )
+  {
+    return;
+  }
+
+  //Err << getPathFromInstruction(i) << ":" << getLineFromInstruction(i) << "\n"
+  //    << getSourceLine(i) << "\n";
+  if( ConstantExpr * pCE = dyn_cast<ConstantExpr>( pCall->getArgOperand(1)) )
+  {
+    if( GlobalVariable * pGV = dyn_cast<GlobalVariable>( pCE->getOperand(0) ))
+    {
+      if( pGV->hasInitializer() )
+      {
+        if( ConstantArray * pCA = dyn_cast<ConstantArray>( pGV->getInitializer() ))
+        {
+          std::string sSecondParameter = pCA->getAsString();
+          if( sSecondParameter.length() == 0 || (sSecondParameter.length() - 1) % 4 != 0 )
+          {
+            return;
+          }
+          while( sSecondParameter.length() > 1 )
+          {
+            if( sSecondParameter.substr( 0 , 4) != sPatternOne && 
+                sSecondParameter.substr( 0 , 4) != sPatternTwo )
+            {
+              break;
+            }
+            sSecondParameter = sSecondParameter.substr( 4 , sSecondParameter.length() - 4 );
+          }
+
+          if( sSecondParameter.length() == 1 )
+          {
+            C.report(i);
+          }
+        }
+      }
+    }
+  }
+}
+
+
+
+namespace {
+class MySQLBug38769 : public PerfEvoChecker {
+public:
+  void getInterest(CheckerInterest &I) const {
+    I.Opcodes.push_back(Instruction::GetElementPtr);
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static RegisterChecker<MySQLBug38769>
+RegMySQLBug38769("MySQLBug38769", FunctionScope, NeedsLoopInfo);
+}
+
+void MySQLBug38769::visit(Instruction *i, CheckerContext &C)
+{
+    // field[n] of a struct pointed to, e.g. &info->rec_buff[n].
+    if( !match( i , m_GEP( m_Zero() , m_Zero() , m_ConstInt(3) , m_IntValue() ) ) )
+    {
+        return;
+    }
+
+    BasicLoopInfo *LI = C.LI;
+    unsigned Depth = LI->getLoopDepth( i->getParent() );
+    if( Depth == 0 )
+    {
+        return;
+    }
+
+    StringRef sGetType = C.Pass.getTypes().getName( i->getOperand(0)->getType() );
+    if( sGetType.find( "_info" ) == StringRef::npos || sGetType.find("struct") == StringRef::npos )
+    {
+        return;
+    }
+
+    // The loop is controlled by comparing something against a constant.
+    Loop * pLoop = LI->getLoopFor( i->getParent() );
+    BasicBlock * pBlock = C.Pass.getLoopHeader( *LI , pLoop );
+    BranchInst * pBranch = dyn_cast<BranchInst>( pBlock->getTerminator() );
+    if( !pBranch || !pBranch->isConditional() )
+    {
+        return;
+    }
+    if( !match( pBranch->getCondition() , m_ICmp( m_ConstInt() , m_Inst() ) ) &&
+        !match( pBranch->getCondition() , m_ICmp( m_Inst() , m_ConstInt() ) ) )
+    {
+        return;
+    }
+
+    SourceLoc Loc;
+    Instruction * pAt = i;
+    if( !C.Pass.getLocation( i , Loc ) )
+    {
+        pAt = pBranch;
+    }
+    C.report( pAt , Depth );
+}
+
+
+bool PerfEvo::JumpBackToLoop( LoopInfo &li , Loop  *l , BasicBlock * pJumpInst )
+{
+   for( Loop::iterator b = l->begin() , be = l->end() ;b != be ; ++ b  )
    {
-       for( BasicBlock::iterator i = b->begin() , ie = b->end() ; i != ie ; ++ i )
-       {
-          if( BranchInst * pBranchInst = dyn_cast<BranchInst>(i) )
-	  {
-               if( pBranchInst->isConditional() && pBranchInst->getNumSuccessors() == 2 && LI->getLoopDepth( pBranchInst->getParent() ) > 0  )
-	       {
-                   if( ICmpInst * pICmp = dyn_cast<ICmpInst>( pBranchInst->getCondition()))
-		   {
-                       if( pICmp->isEquality() )
-		       {
-		          //pBranchInst->dump();
-		          Loop * pLoop = LI->getLoopFor( pBranchInst->getParent() );
-			  BasicBlock * pBlock = pLoop->getHeader();
-                          //pBlock->dump();
-			  unsigned uHeadLineNum = 0;
-
-			  for( BasicBlock::iterator iHeader = pBlock->begin() , ieHeader = pBlock->end() ; iHeader != ieHeader ; iHeader ++ )
-			  {
-                              if( BranchInst * pHeadBranchInst = dyn_cast<BranchInst>(iHeader) )
-			      {
-                                  std::string sHeadFile;
-				  getPathAndLineNo( pHeadBranchInst , sHeadFile, uHeadLineNum);
-				  break;
-			      }
-			  }
-
-			  std::string sTmp;
-			  unsigned uTmp = 0;
-			  getPathAndLineNo( pBranchInst , sTmp , uTmp );
-			
+       //if( b == pJumpInst )
+       //{
+       //   return true;
+       //}
+   }
 
-			  if( !( uHeadLineNum == uTmp  && uHeadLineNum != 0) )
-			  {
-                              continue;
-			  }
-			 
-
-			  BasicBlock * pBasicBlockOne = pBranchInst->getSuccessor(0);
-                          BasicBlock * pBasicBlockTwo = pBranchInst->getSuccessor(1);
-                          if( !(pLoop->contains(pBasicBlockOne)&& !pLoop->contains(pBasicBlockTwo)) )
-			  {
-                             continue;
-			  }
-                          
-			  Value * arrayPtr;
-			  if( ConstantInt * pConstantInt = dyn_cast<ConstantInt>( pICmp->getOperand(0)) )
-			  {
-			      //Value * arrayPtr;
-
-                              if( !isa<ConstantInt>( pICmp->getOperand(1)) )
-			      {
-                                  if( pConstantInt->getType()->isIntegerTy(8) )
-				  {
-                                      arrayPtr = pICmp->getOperand(1);
-				  }
-				  else
-				  {
-                                      continue;
-				  }
-			      }
-			      else
-			      {
-			          continue;
-			      }
-			  }
-			  else if( ConstantInt * pConstantInt = dyn_cast<ConstantInt>( pICmp->getOperand(1)) )
-			  {
-                               if( !isa<ConstantInt>(pICmp->getOperand(0) ) )
-			       {
-                                   if( pConstantInt->getType()->isIntegerTy(8) )
-				   {
-				       arrayPtr = pICmp->getOperand(0);
-				   }
-				   else
-				   {
-				      continue;
-				   }
-			       }
-			       else
-			       {
-			           continue;
-			       }
-			  }
-			  else
-			  {
-                               continue;
-			  }
+   return false;
+}
 
 
-			  if( LoadInst * pLoad = dyn_cast<LoadInst>( arrayPtr ))
-			  {
-                              if( LI->getLoopDepth(pLoad->getParent()) > 0 )
-			      {
-                                  if( GetElementPtrInst * pGet = dyn_cast<GetElementPtrInst>(pLoad->getOperand(0)))
-				  {
-                                      if( LI->getLoopDepth( pGet->getParent() ) > 0  )
-				      {
-                                          if( pGet->getNumOperands() == 2 )
-					  {
-                                               if( pGet->getOperand(0)->getType()->isPointerTy() && pGet->getOperand(1)->getType()->isIntegerTy() )
-					       {
-                                             
-                                                   //Loop * pLoop = LI->getLoopFor( pBranchInst->getParent() );
-                                                   //int iNum = 0 ;
-                                                   //for( Loop::iterator itBegin = pLoop->begin() , itEnd = pLoop->end(); itBegin != itEnd ; itBegin ++)
-                                                   //{
-                                                   //    iNum ++;
-                                                   //}    
-                                                   //if( iNum > 0 )
-                                                   //{
-                                                   //    continue;
-                                                   //}
-                                                   std::string strPath;
-						   unsigned uLineNo;
-                                                   //i->dump();
-						   getPathAndLineNo( pICmp, strPath, uLineNo);
-                                                   //std::cout << "Block Num:" << iNum  << std::endl; 
-						   std::cout << strPath << ":" << uLineNo << std::endl;
-						   std::cout << "\t"<< getSourceLine(strPath, uLineNo) << std::endl;
-					       }
-					  }
-				      }
-				  }
-			      }
-			  }
- 
-		       }
-		   }
-	       }
-	  }
-	 
-         
-       }
+
+namespace {
+class MySQLBug14637 : public PerfEvoChecker {
+public:
+  void getInterest(CheckerInterest &I) const {
+    I.Opcodes.push_back(Instruction::Br);
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static RegisterChecker<MySQLBug14637>
+RegMySQLBug14637("MySQLBug14637", FunctionScope, NeedsLoopInfo);
+}
+
+void MySQLBug14637::visit(Instruction *i, CheckerContext &C) 
+{
+   const BasicLoopInfo *LI = C.LI;
+
+   BranchInst * pBranchInst = cast<BranchInst>(i);
+   if( !pBranchInst->isConditional() || LI->getLoopDepth( pBranchInst->getParent() ) == 0 )
+   {
+       return;
    }
+
+   // A char read through a pointer compared with a char constant, as in
+   // while( *p != 'x' ).
+   ICmpInst * pICmp;
+   LoadInst * pLoad;
+   GetElementPtrInst * pGet;
+   if( !match( pBranchInst->getCondition() ,
+               m_Bind( pICmp , m_ICmpEquality( m_Bind( pLoad , m_Load( m_Bind( pGet , m_GEP( m_Value() ) ) ) ) ,
+                                               m_ConstI8() ) ) ) )
+   {
+       return;
+   }
+   if( LI->getLoopDepth( pLoad->getParent() ) == 0 || LI->getLoopDepth( pGet->getParent() ) == 0 )
+   {
+       return;
+   }
+
+   // The compare is the loop condition, on the line of the loop header.
+   Loop * pLoop = LI->getLoopFor( pBranchInst->getParent() );
+   BranchInst * pHeadBranchInst = dyn_cast<BranchInst>( pLoop->getHeader()->getTerminator() );
+   SourceLoc HeadLoc , BranchLoc;
+   if( !pHeadBranchInst || !C.Pass.getLocation( pHeadBranchInst , HeadLoc ) ||
+       !C.Pass.getLocation( pBranchInst , BranchLoc ) )
+   {
+       return;
+   }
+   if( !( HeadLoc.Line == BranchLoc.Line && HeadLoc.Line != 0 ) )
+   {
+       return;
+   }
+
+   // It stays in the loop while the compare is true.
+   if( !( pLoop->contains( pBranchInst->getSuccessor(0) ) && !pLoop->contains( pBranchInst->getSuccessor(1) ) ) )
+   {
+       return;
+   }
+
+   C.report( pICmp , LI->getLoopDepth( pGet->getParent() ) );
 }
 
-void PerfEvo::MySQLBug39268(Function &F)
+namespace {
+class MySQLBug39268 : public PerfEvoChecker {
+  const Type *NdbPtrTy;
+public:
+  MySQLBug39268() : NdbPtrTy(0) {}
+  void beginFunction(CheckerContext &C) {
+    NdbPtrTy = C.Pass.getTypes().lookup("%struct.Ndb*");
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static const char *const MySQLBug39268Triggers[] = {
+  "startTransaction", 0
+};
+static RegisterChecker<MySQLBug39268>
+RegMySQLBug39268("MySQLBug39268", FunctionScope, NoAnalyses,
+                 MySQLBug39268Triggers);
+}
+
+void MySQLBug39268::visit(Instruction *i, CheckerContext &C)
 {
    //if( F.getName().find( "ndbcluster_log_schema_op" ) == std::string::npos )//|| F.getName().find("opTupleIdOnNdb") == std::string::npos )
    //{
@@ -2023,94 +2478,64 @@ void PerfEvo::MySQLBug39268(Function &F)
 
 
 #if 1  
-   TypePrinting Printer;
-   std::vector<const Type *> NumberedTypes;
-   AddModuleTypesToPrinter( Printer , NumberedTypes , _M );
-
-   for( Function::iterator b = F.begin() , be = F.end() ; b != be; ++ b )
+   CallInst * pCall = dyn_cast<CallInst>( i );
+   if( !pCall || !NdbPtrTy )
    {
-      for( BasicBlock::iterator i = b->begin() , ie = b->end() ; i != ie ; ++ i )
-      {
-          if( CallInst * pCall = dyn_cast<CallInst>( i ) )
-	  {
-              Function * pFunction = pCall->getCalledFunction();
-	      if( !pFunction )
-	      {
-                 continue;
-	      }
+      return;
+   }
 
-	      std::string sFunction = pFunction->getName();
-	      if( sFunction.find("startTransaction") != std::string::npos )
-	      {
-                   //pCall->getOperand(0)->dump();
+   //pCall->getOperand(0)->dump();
 
-		   if( Value * pArgument = dyn_cast<Value>(pCall->getOperand(0)) )
-		   {
-		       //pCall->getOperand(0)->getType()->dump();
-		       std::string sResult;
-		       raw_string_ostream rstring( sResult );
-		       Printer.print( pArgument->getType() , rstring );
-	               std::string sOperandOne = rstring.str();
-		       //std::cout << "Here" << std::endl;
-		       //std::cout << sOperandOne << std::endl;
-		       if( sOperandOne != "%struct.Ndb*" )
-		       {
-                           continue;
-		       }
-                       //std::cout << sOperandOne  << std::endl;
-		   }
-		   else
-		   {
-		       continue;
-		   }
+   if( Value * pArgument = dyn_cast<Value>(pCall->getOperand(0)) )
+   {
+       //pCall->getOperand(0)->getType()->dump();
+       if( pArgument->getType() != NdbPtrTy )
+       {
+           return;
+       }
+       //std::cout << sOperandOne  << std::endl;
+   }
+   else
+   {
+       return;
+   }
 
-		   //std::cout << pCall->getOperand(1)->getNameStr() << std::endl;
+   //std::cout << pCall->getOperand(1)->getNameStr() << std::endl;
 
-		   if( Constant * pConstant = dyn_cast<Constant>( pCall->getOperand(1) ))
-		   {
-                       //std::cout << pConstant->isNullValue()  << std::endl;
-		       if( !pConstant->isNullValue() )
-		       {
-                          continue;
-		       }
-		   }
-		   else
-		   {
-		       continue;
-		   }
-                   
-		   for( Value::use_iterator u = pCall->use_begin() , ue = pCall->use_end() ; u != ue ; u ++ )
-		   {
-                       if( CallInst * pUseCall = dyn_cast<CallInst>( *u ) )
-		       {
-                           Function * pFun = pUseCall->getCalledFunction();
-			   if(!pFun)
-			   {
-                               continue;
-			   }
+   if( Constant * pConstant = dyn_cast<Constant>( pCall->getOperand(1) ))
+   {
+       //std::cout << pConstant->isNullValue()  << std::endl;
+       if( !pConstant->isNullValue() )
+       {
+          return;
+       }
+   }
+   else
+   {
+       return;
+   }
 
-			   std::string sFunName = pFun->getName();
-                           //std::cout << sFunName << std::endl;
-			   if( sFunName.find( "getNdbOperation" ) != std::string::npos )
-			   {
-                                std::string strPath;
-				unsigned uLineNo;
-				getPathAndLineNo( pCall , strPath , uLineNo );
-				std::cout << strPath << " : " << uLineNo << std::endl;
-				std::cout << "\t" << getSourceLine( strPath , uLineNo ) << std::endl;
-
-				getPathAndLineNo( pUseCall , strPath , uLineNo );
-				std::cout << strPath << " : " << uLineNo << std::endl;
-				std::cout << "\t" << getSourceLine(strPath , uLineNo ) << std::endl;
-				std::cout << "========================================" << std::endl;
-			   }
-		       }
-		   }
-		   
-		
-	      }
-	  }
-      }
+   for( Value::use_iterator u = pCall->use_begin() , ue = pCall->use_end() ; u != ue ; u ++ )
+   {
+       if( CallInst * pUseCall = dyn_cast<CallInst>( *u ) )
+       {
+           Function * pFun = pUseCall->getCalledFunction();
+           if(!pFun)
+           {
+               continue;
+           }
+
+           std::string sFunName = pFun->getName();
+           //std::cout << sFunName << std::endl;
+           if( sFunName.find( "getNdbOperation" ) != std::string::npos )
+           {
+                Finding R;
+                R.Loc = C.getLoc( pCall );
+                R.Related.push_back( C.getLoc( pUseCall , "getNdbOperation on the new transaction" ) );
+                R.Message = "transaction started without a hint";
+                C.report( R );
+           }
+       }
    }
 
 #endif
@@ -2122,148 +2547,485 @@ void PerfEvo::MySQLBug39268(Function &F)
 //
 //}
 
-void PerfEvo::MySQLBug48229(Function &F)
+namespace {
+class MySQLBug48229 : public PerfEvoChecker {
+public:
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static const char *const MySQLBug48229Triggers[] = {
+  "val_str", 0
+};
+static RegisterChecker<MySQLBug48229>
+RegMySQLBug48229("MySQLBug48229", FunctionScope, NoAnalyses,
+                 MySQLBug48229Triggers);
+}
+
+void MySQLBug48229::visit(Instruction *i, CheckerContext &C)
 {
    //std::cout << F.getNameStr() << std::endl;
-   for( Function::iterator b = F.begin() , be = F.end() ; b != be ; ++ b )
+   CallInst * pCall = dyn_cast<CallInst>(i);
+   if( !pCall )
    {
-      for(BasicBlock::iterator i = b->begin() , ie = b->end() ; i != ie ; ++ i )
-      {
-         if(CallInst * pCall = dyn_cast<CallInst>(i) )
-	 {
-            Function * pFunction = pCall->getCalledFunction();
-	    if(!pFunction)
-	    {
-               continue;
-	    }
-	    if( pCall->getNumArgOperands() != 2 )
-	    {
-               continue;
-	    }
-	    std::string sFunction = pFunction->getName();
-	    if( sFunction.find("val_str") != std::string::npos /*&& sFunction.find("info") != std::string::npos*/ )
-	    {
-                std::string strPath;
-		unsigned uLineNo;
-		getPathAndLineNo(pCall , strPath , uLineNo );
-		std::cout << strPath << " : " << uLineNo << std::endl;
-		std::cout << "\t" << getSourceLine(strPath , uLineNo ) << std::endl;
-	    }
-	 }
-      }
+      return;
+   }
+   if( pCall->getNumArgOperands() != 2 )
+   {
+      return;
    }
+   /* && sFunction.find("info") != std::string::npos */
+   C.report(pCall);
+}
+
+namespace {
+class ApacheBug33605 : public PerfEvoChecker {
+public:
+  void getInterest(CheckerInterest &I) const {
+    I.Opcodes.push_back(Instruction::Call);
+    I.Opcodes.push_back(Instruction::Invoke);
+  }
+  void visit(Instruction *i, CheckerContext &C);
+};
+
+static RegisterChecker<ApacheBug33605>
+RegApacheBug33605("ApacheBug33605", FunctionScope, NoAnalyses);
 }
 
-void PerfEvo::ApacheBug33605(Function &F) 
+void ApacheBug33605::visit(Instruction *i, CheckerContext &C) 
 {
   std::string sFunctionName = "setsockopt";
-  for (Function::iterator b = F.begin(), be = F.end(); b != be; ++b) 
+  SourceLoc Loc;
+  bool HasLoc = C.Pass.getLocation(i, Loc);
+  assert(HasLoc && "No DebugInfo");
+
+  if (HasLoc && C.Pass.sourceLineContains(Loc, sFunctionName)) 
   {
-    for (BasicBlock::iterator i = b->begin(), ie = b->end(); i != ie; ++i) 
-    {
-      if (isa<CallInst>(&(*i)) || isa<InvokeInst>(&(*i))) 
-      {
-        std::string strPath;
-        unsigned uLineNo = 0;
-        assert(getPathAndLineNo(i, strPath, uLineNo) && "No DebugInfo");
+    C.report(i);
+  }
+}
 
-        if (getSourceLine(strPath, uLineNo).find(sFunctionName) !=
-                std::string::npos) 
-        {
-          Err << strPath << ":" << uLineNo << "\n"
-              << getSourceLine(strPath, uLineNo) << "\n";
-        }
-      }
-    }
+// Guards loading the -perfRules files, which happens once per process.
+static sys::Mutex RulesLock;
+static bool RulesLoaded = false;
+
+/// loadRules - Add the checkers of the -perfRules files to the registry.
+static void loadRules() {
+  sys::SmartScopedLock<false> Guard(RulesLock);
+  if (RulesLoaded)
+    return;
+  RulesLoaded = true;
+  for (unsigned i = 0, e = RuleFiles.size(); i != e; ++i) {
+    std::string ErrMsg;
+    if (!loadRuleFile(RuleFiles[i], ErrMsg))
+      report_fatal_error(ErrMsg);
   }
 }
 
-void PerfEvo::LoopNestedCallSites(Function &F) {
-  LoopInfo &li = getAnalysis<LoopInfo>();
+static sys::Mutex ProfileLock;
+static Profile SharedProfile;
+
+/// loadProfile - Read the -perfProfile file the first time it is needed.
+/// All PerfEvo instances of the process share it, so perfevo-batch parses
+/// it once rather than once per module.
+static const Profile *loadProfile() {
+  sys::SmartScopedLock<false> Guard(ProfileLock);
+  if (!SharedProfile.isLoaded()) {
+    PhaseTimer T("profile");
+    std::string ErrMsg;
+    if (!SharedProfile.load(ProfileFilename, ErrMsg))
+      report_fatal_error(ErrMsg);
+  }
+  return &SharedProfile;
+}
 
-  std::list<Instruction *> csl = searchCallSites(F, "");
+/// getSelectedCheckers - Resolve -perfBugID to registry entries, in the
+/// order given and without duplicates.
+void PerfEvo::getSelectedCheckers(std::vector<const CheckerInfo*> &Selected) {
+  loadRules();
+  std::set<const CheckerInfo*> Seen;
+  for (unsigned i = 0, e = PerfBugIDs.size(); i != e; ++i) {
+    if (PerfBugIDs[i] == "all") {
+      for (CheckerRegistry::iterator I = CheckerRegistry::begin(),
+           E = CheckerRegistry::end(); I != E; ++I)
+        if (Seen.insert(*I).second)
+          Selected.push_back(*I);
+      continue;
+    }
 
-  for (std::list<Instruction *>::iterator cs = csl.begin(), cse = csl.end();
-      cs != cse; ++cs) {
-    BasicBlock *bb = (*cs)->getParent();
-    unsigned int ld = li.getLoopDepth(bb);
+    const CheckerInfo *Info = CheckerRegistry::lookup(PerfBugIDs[i]);
+    if (!Info)
+      report_fatal_error("No checker implemented for bug " + PerfBugIDs[i]);
+    if (Seen.insert(Info).second)
+      Selected.push_back(Info);
+  }
+}
 
-    if (ld > 0) {
-      std::string strPath;
-      unsigned uLineNo=0;
-      assert(getPathAndLineNo(*cs, strPath, uLineNo) && "No DebugInfo");
+/// getTriggered - Set bit i of Triggered if M has a function whose name
+/// contains one of the triggers of Checkers[i].  Every name is matched
+/// against all triggers at once.
+static void getTriggered(const Module &M,
+                         const std::vector<const CheckerInfo*> &Checkers,
+                         BitVector &Triggered) {
+  CalleeMatcher Triggers;
+  for (unsigned i = 0, e = Checkers.size(); i != e; ++i)
+    if (const char *const *T = Checkers[i]->Triggers)
+      for (; *T; ++T)
+        Triggers.add(*T, i);
+  Triggers.compile();
+
+  Triggered.resize(Checkers.size());
+  if (Triggers.empty())
+    return;
+  for (Module::const_iterator f = M.begin(), fe = M.end(); f != fe; ++f)
+    Triggers.match(f->getName(), Triggered);
+}
 
-      Err << strPath << ":" << uLineNo << "\n"
-          << getSourceLine(strPath, uLineNo) << "\n"
-          << "LoopDepth: " << li.getLoopDepth(bb) << "\n";
-    }
-  }  
+/// report - Write the findings for F, or for the module if F is null, or
+/// pass them on to the collector.
+void PerfEvo::report(const Function *F, StringRef Text) {
+  if (Text.empty())
+    return;
+  if (Collector)
+    Collector->addReport(F ? F->getName() : StringRef(), Text);
+  else
+    Writer->write(Text);
 }
 
 bool PerfEvo::doInitialization(Module &M) {
   _M = &M;
-  if (!bBugHandlerInited) {
-    if (strPerfBugID == "MozillaBug35294")
-      pBugHandler = &PerfEvo::MozillaBug35294;
-    else if (strPerfBugID == "MozillaBug66461")
-      pBugHandler = &PerfEvo::MozillaBug66461;
-    else if (strPerfBugID == "MozillaBug267506")
-      pBugHandler = &PerfEvo::MozillaBug267506;
-    else if (strPerfBugID == "MozillaBug311566")
-      pBugHandler = &PerfEvo::MozillaBug311566;
-    else if (strPerfBugID == "MozillaBug103330")
-      pBugHandler = &PerfEvo::MozillaBug103330;
-    else if (strPerfBugID == "MozillaBug258793")
-      pBugHandler = &PerfEvo::MozillaBug258793;
-    else if (strPerfBugID == "MozillaBug409961")
-      pBugHandler = &PerfEvo::MozillaBug409961;
-    else if (strPerfBugID == "MySQLBug26527")
-      pBugHandler = &PerfEvo::MySQLBug26527;
-    else if (strPerfBugID == "MySQLBug38941")
-      pBugHandler = &PerfEvo::MySQLBug38941;
-    else if (strPerfBugID == "MySQLBug38968")
-      pBugHandler = NULL; //&PerfEvo::MySQLBug38968;
-    else if (strPerfBugID == "MySQLBug38769")
-      pBugHandler = &PerfEvo::MySQLBug38769;
-    else if (strPerfBugID == "MySQLBug49491")
-      pBugHandler = &PerfEvo::MySQLBug49491;
-    else if (strPerfBugID == "MySQLBug38824")
-      pBugHandler = &PerfEvo::MySQLBug38824;
-    else if (strPerfBugID == "MySQLBug14637")
-      pBugHandler = &PerfEvo::MySQLBug14637;
-    else if (strPerfBugID == "MySQLBug39268")
-      pBugHandler = &PerfEvo::MySQLBug39268;
-    //else if (strPerfBugID == "MySQLBug15811")
-    //  pBugHandler = &PerfEvo::MySQLBug15811;
-    else if (strPerfBugID == "ApacheBug33605")
-      pBugHandler = &PerfEvo::ApacheBug33605;
-    else if (strPerfBugID == "ApacheBug45464")
-      pBugHandler = &PerfEvo::ApacheBug45464;
-    else if(strPerfBugID == "MySQLBug48229")
-      pBugHandler = &PerfEvo::MySQLBug48229;
-    // else if (strPerfBugID == "ApacheBug45464")
-    //   LoopNestedCallSites(F);
-    else
-      assert(false && "No checker implemented for this bug yet");
-    if (strPerfBugID != "MySQLBug38968")
-      loadSourceFiles(&M);
-    else
-      MySQLBug38968();
+  FunctionCheckers.clear();
+  Checkers.clear();
+  FunctionNumbers.clear();
+  NumRanked = 0;
+  if (rankFindings()) {
+    // Zero is for module scope checkers, which run first.
+    unsigned N = 0;
+    for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f)
+      FunctionNumbers[f] = ++N;
   }
+
+  // Findings go through one large buffer rather than the unbuffered errs().
+  if (!Collector) {
+    if (!OwnedOut) {
+      if (OutputFilename.empty()) {
+        OwnedOut.reset(new raw_fd_ostream(2, false));
+      } else {
+        std::string ErrorInfo;
+        OwnedOut.reset(new raw_fd_ostream(OutputFilename.c_str(), ErrorInfo));
+        if (!ErrorInfo.empty())
+          report_fatal_error(ErrorInfo);
+      }
+      OwnedOut->SetBufferSize(1 << 16);
+    }
+    Writer.reset(new FindingsWriter(*OwnedOut, Format));
+  }
+
+  // Source lines are mapped in on demand by getSourceLine.
+  {
+    PhaseTimer T("type table");
+    Types.reset(&M);
+  }
+  if (Cache) {
+    PhaseTimer T("fingerprint");
+    Declarations = FunctionHasher(Types, Locations).hashDeclarations(M);
+  }
+  {
+    PhaseTimer T("call site index");
+    CallSites.build(M);
+  }
+  if (!ProfileFilename.empty())
+    Samples = loadProfile();
+
+  std::vector<const CheckerInfo*> Selected;
+  getSelectedCheckers(Selected);
+  BitVector Triggered;
+  getTriggered(M, Selected, Triggered);
+
+  for (unsigned i = 0, e = Selected.size(); i != e; ++i) {
+    const CheckerInfo *Info = Selected[i];
+    // Checkers with triggers only apply if something they look for exists.
+    if (Info->Triggers && !Triggered.test(i))
+      continue;
+
+    if (Info->Scope == ModuleScope) {
+      std::string Buf;
+      raw_string_ostream Out(Buf);
+      PerfEvoChecker *C = Info->Create(*Info);
+      StatsTimer T;
+      C->runOnModule(*this, Out);
+      if (PerfStats *Stats = PerfStats::get()) {
+        CheckerCounters CC;
+        T.getElapsed(CC.Wall, CC.CPU);
+        Stats->addPhase("module checkers", CC.Wall, CC.CPU);
+        Stats->addFunction(Info->ID, StringRef(), CC);
+      }
+      delete C;
+      report(0, Out.str());
+      continue;
+    }
+    FunctionCheckers.push_back(Info);
+  }
+
+  if (getNumThreads() > 1) {
+    if (FunctionCheckers.empty())
+      return false;
+
+    std::vector<Function*> Functions;
+    for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f)
+      if (!f->isDeclaration())
+        Functions.push_back(f);
+
+    std::vector<std::string> Outputs;
+    {
+      PhaseTimer T("function checkers");
+      runCheckersInParallel(*this, Functions, FunctionCheckers, getNumThreads(),
+                            Outputs);
+    }
+    for (unsigned i = 0, e = Functions.size(); i != e; ++i)
+      report(Functions[i], Outputs[i]);
+    return false;
+  }
+
+  for (unsigned i = 0, e = FunctionCheckers.size(); i != e; ++i)
+    Checkers.add(FunctionCheckers[i]);
   //Err << "Initialization Done!\n";
   return false;
 }
 
+// Bump whenever a change to a checker, or to the code the checkers use,
+// changes what they report for the same function.  Cached output from other
+// versions is then ignored.
+static const unsigned AnalysisVersion = 1;
+
+static void addOption(FNVHash &H, const cl::list<std::string> &List) {
+  H.add(List.size());
+  for (unsigned i = 0, e = List.size(); i != e; ++i)
+    H.add(StringRef(List[i]));
+}
+
+/// getOptionsHash - Hash AnalysisVersion and every option that changes what
+/// function checkers report.
+static uint64_t getOptionsHash() {
+  FNVHash H;
+  H.add(AnalysisVersion);
+  H.add((uint64_t)Format);
+  H.add(TripCounts ? 1 : 0);
+  H.add(UnknownTripCount);
+  H.add(DataflowSolver::getVisitLimit());
+  addOption(H, ExpensiveCalls);
+  addOption(H, Allocators);
+  addOption(H, Deallocators);
+  return H.get();
+}
+
+void PerfEvo::checkFunction(CheckerSet &Set, Function &F, BasicLoopInfo *LI,
+                            ScalarEvolution *SE, std::string &Output) {
+  unsigned N = Set.size();
+  std::vector<std::string> Buffers(N);
+  std::vector<raw_ostream*> Outs(N);
+  std::vector<StringRef> Cached(N);
+  std::vector<uint64_t> Keys(N);
+  unsigned Needed = NoAnalyses;
+  bool AllCached = true;
+
+  // A checker's output for F is cached under the hash of its ID, its rule
+  // text if any, F's fingerprint, the module's declarations, the analysis
+  // version and the options that affect findings.
+  uint64_t Fingerprint = 0, Options = 0;
+  if (Cache) {
+    PhaseTimer T("fingerprint");
+    Fingerprint = FunctionHasher(Types, Locations).hash(F);
+    Options = getOptionsHash();
+  }
+
+  for (unsigned i = 0; i != N; ++i) {
+    const CheckerInfo *Info = Set.getInfo(i);
+    if (Cache) {
+      FNVHash H;
+      H.add(Fingerprint);
+      H.add(Declarations);
+      H.add(StringRef(Info->ID));
+      if (Info->Source)
+        H.add(StringRef(Info->Source));
+      H.add(Options);
+      Keys[i] = H.get();
+      if (Cache->lookup(Keys[i], Cached[i]))
+        continue;
+    }
+    Outs[i] = new raw_string_ostream(Buffers[i]);
+    Needed |= Info->Analyses;
+    AllCached = false;
+  }
+
+  if (!AllCached) {
+    DominatorTreeBase<BasicBlock> DT(false);
+    BasicLoopInfo OwnLI;
+    if ((Needed & NeedsLoopInfo) && !LI) {
+      PhaseTimer T("loop info");
+      DT.recalculate(F);
+      OwnLI.Calculate(DT);
+      LI = &OwnLI;
+    }
+    Set.run(*this, F, LI, SE, Outs);
+  }
+
+  for (unsigned i = 0; i != N; ++i) {
+    if (!Outs[i]) {
+      Output += Cached[i];
+      continue;
+    }
+    delete Outs[i];
+    if (Cache)
+      Cache->insert(Keys[i], Buffers[i]);
+    Output += Buffers[i];
+  }
+}
+
+/// runOnFunction - Walk F once, handing every instruction to the checkers
+/// that asked for it.  With -perfThreads the work was already done in
+/// doInitialization.
 bool PerfEvo::runOnFunction(Function &F) {
-  if (strPerfBugID != "MySQLBug38968")
-    (this->*pBugHandler)(F);
+  if (Checkers.empty() || F.isDeclaration())
+    return false;
+
+  // With a cache, loop information is only computed for functions that
+  // actually have to be checked.
+  BasicLoopInfo *LI = 0;
+  ScalarEvolution *SE = 0;
+  if (!Cache && (Checkers.getAnalyses() & NeedsLoopInfo)) {
+    LI = &getAnalysis<LoopInfo>().getBase();
+    if (TripCounts)
+      SE = &getAnalysis<ScalarEvolution>();
+  }
+
+  std::string Output;
+  {
+    PhaseTimer T("function checkers");
+    checkFunction(Checkers, F, LI, SE, Output);
+  }
+  report(&F, Output);
   return false;
 }
 
-// We don't modify the program, so we preserve all analyses
+bool PerfEvo::weighFinding(Finding &R) {
+  if (!Samples)
+    return true;
+  R.Samples = Samples->getLineSamples(R.Loc.File, R.Loc.Line);
+  if (!R.Samples)
+    R.Samples = Samples->getFunctionSamples(R.Function);
+  R.Profiled = true;
+  return R.Samples >= ProfileThreshold;
+}
+
+void PerfEvo::addRankedFinding(const Finding &R, const Function *F) {
+  // A function's findings come from one thread, in order, so the count of
+  // findings so far orders them within the function.
+  uint64_t Number = F ? FunctionNumbers.lookup(F) : 0;
+  sys::SmartScopedLock<false> Guard(RankedLock);
+  Ranked.push_back(R);
+  Ranked.back().Order = Number << 32 | NumRanked++;
+}
+
+static bool isEarlier(const Finding &A, const Finding &B) {
+  return A.Order < B.Order;
+}
+
+static bool isMoreFrequent(const Finding &A, const Finding &B) {
+  if (A.Samples != B.Samples)
+    return A.Samples > B.Samples;
+  if (A.EstimatedCount != B.EstimatedCount)
+    return A.EstimatedCount > B.EstimatedCount;
+  return isEarlier(A, B);
+}
+
+/// sortByWeight - Those with the most samples come first and, among those
+/// with equally many, those estimated to run most often.  Findings that tie
+/// come in the order a serial run finds them.
+void PerfEvo::sortByWeight(std::vector<Finding> &Findings) {
+  std::stable_sort(Findings.begin(), Findings.end(), isMoreFrequent);
+  if (NumTop && NumTop < Findings.size())
+    Findings.resize(NumTop);
+}
+
+/// reportRanked - Write the findings kept with -perfTripCounts or
+/// -perfProfile by weight, or pass them on to a collector that ranks the
+/// findings of all modules together.
+void PerfEvo::reportRanked() {
+  if (Collector && Collector->ranksFindings()) {
+    std::sort(Ranked.begin(), Ranked.end(), isEarlier);
+    if (!Ranked.empty())
+      Collector->addRankedFindings(Ranked);
+    Ranked.clear();
+    return;
+  }
+
+  sortByWeight(Ranked);
+  std::string Text;
+  raw_string_ostream Out(Text);
+  for (unsigned i = 0, e = Ranked.size(); i != e; ++i)
+    writeFinding(Ranked[i], Out);
+  Ranked.clear();
+  report(0, Out.str());
+}
+
+bool PerfEvo::doFinalization(Module &M) {
+  reportRanked();
+  if (Writer) {
+    Writer->finish();
+    Writer.reset();
+  }
+  CallSites.clear();
+  GlobalUses.clear();
+
+  if (OwnedCache) {
+    PhaseTimer T("cache save");
+    std::string ErrMsg;
+    if (!OwnedCache->save(ErrMsg))
+      Err << "PerfEvo: " << CacheFilename << ": " << ErrMsg << "\n";
+  }
+  return false;
+}
+
+StringRef PerfEvo::getCacheFilename() {
+  return CacheFilename;
+}
+
+unsigned PerfEvo::getNumThreads() {
+  // Decided once, so getAnalysisUsage and doInitialization agree.
+  static unsigned Threads = 0;
+  if (Threads == 0) {
+    Threads = NumThreads;
+    if (Threads > 1 && !llvm_is_multithreaded() &&
+        !llvm_start_multithreaded()) {
+      errs() << "warning: LLVM was built without thread support, "
+             << "ignoring -perfThreads\n";
+      Threads = 1;
+    }
+  }
+  return Threads;
+}
+
+// We don't modify the program, so we preserve all analyses.  Only the
+// analyses the selected checkers registered for are computed; in parallel
+// mode, or with a cache, checkFunction computes them when needed.
 void PerfEvo::getAnalysisUsage(AnalysisUsage &AU) const {
   AU.setPreservesAll();
-  AU.addRequired<LoopInfo>();
+  if (getNumThreads() > 1 || Cache)
+    return;
+
+  std::vector<const CheckerInfo*> Selected;
+  getSelectedCheckers(Selected);
+
+  unsigned Needed = NoAnalyses;
+  for (unsigned i = 0, e = Selected.size(); i != e; ++i)
+    if (Selected[i]->Scope == FunctionScope)
+      Needed |= Selected[i]->Analyses;
+
+  if (Needed & NeedsLoopInfo) {
+    AU.addRequired<LoopInfo>();
+    if (TripCounts)
+      AU.addRequired<ScalarEvolution>();
+  }
 }
 
 char PerfEvo::ID = 0;
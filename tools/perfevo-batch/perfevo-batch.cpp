@@ -0,0 +1,263 @@
+//===- perfevo-batch.cpp - Check many bitcode files with PerfEvo ----------===//
+//
+// perfevo-batch runs the PerfEvo checkers over every bitcode file listed in a
+// manifest, several files at a time, in one process:
+//
+//   perfevo-batch -perfBugID=all -j 8 -o report.txt files.txt
+//
+// The manifest names one bitcode file per line.  Blank lines and lines
+// starting with '#' are ignored, and relative paths are taken relative to the
+// manifest.  All modules share one source line cache, so a source file is
+// read once no matter how many modules were compiled from it.
+//
+// The report lists the output of each module in manifest order.  Output that
+// an earlier module already produced, such as a finding in an inline function
+// from a shared header, is printed only once.  -perfFormat selects the
+// format of the report as it does for the pass.
+//
+// With -perfCache all modules share one analysis cache, which is written
+// back once every file has been checked.
+//
+// With -perfTripCounts or -perfProfile, the findings of all modules are
+// ranked together and listed after the other output, so -perfTop keeps the
+// N heaviest findings of the whole program.
+//
+//===----------------------------------------------------------------------===//
+
+#include "perfevo.h"
+#include "AnalysisCache.h"
+#include "SourceCache.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/PassManager.h"
+#include "llvm/ADT/OwningPtr.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/System/Mutex.h"
+#include "llvm/System/Signals.h"
+#include "llvm/System/Threading.h"
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+using namespace llvm;
+
+static cl::opt<std::string>
+ManifestFilename(cl::Positional, cl::desc("<manifest>"), cl::Required);
+
+static cl::opt<std::string>
+OutputFilename("o", cl::desc("Write the merged report to this file"),
+               cl::value_desc("filename"), cl::init("-"));
+
+static cl::opt<unsigned>
+NumJobs("j", cl::desc("Number of bitcode files to check at once"),
+        cl::value_desc("N"), cl::init(1));
+
+namespace {
+/// ModuleReports - Everything PerfEvo printed for one module, in order.
+class ModuleReports : public ReportCollector {
+public:
+  std::vector<std::string> Reports;
+  // The findings to rank with those of the other modules.
+  std::vector<Finding> Ranked;
+  // Set if the module could not be read.
+  std::string Error;
+
+  void addReport(StringRef Func, StringRef Text) {
+    Reports.push_back(Text.str());
+  }
+  bool ranksFindings() const { return true; }
+  void addRankedFindings(const std::vector<Finding> &Findings) {
+    Ranked.insert(Ranked.end(), Findings.begin(), Findings.end());
+  }
+};
+
+/// BatchQueue - The work shared by all worker threads.
+struct BatchQueue {
+  const std::vector<std::string> *Files;
+  std::vector<ModuleReports> *Results;
+  SourceCache *Sources;
+  AnalysisCache *Cache;
+
+  sys::Mutex Lock;
+  unsigned Next;
+};
+}
+
+/// readManifest - Read the bitcode file names listed in Filename.
+static bool readManifest(const std::string &Filename,
+                         std::vector<std::string> &Files,
+                         std::string &ErrMsg) {
+  OwningPtr<MemoryBuffer> Buffer(MemoryBuffer::getFile(Filename, &ErrMsg));
+  if (!Buffer)
+    return false;
+
+  std::string Dir;
+  std::string::size_type Slash = Filename.rfind('/');
+  if (Slash != std::string::npos)
+    Dir = Filename.substr(0, Slash + 1);
+
+  StringRef Rest = Buffer->getBuffer();
+  while (!Rest.empty()) {
+    std::pair<StringRef, StringRef> Split = Rest.split('\n');
+    StringRef Line = Split.first.trim();
+    Rest = Split.second;
+
+    if (Line.empty() || Line[0] == '#')
+      continue;
+    if (Line[0] == '/')
+      Files.push_back(Line.str());
+    else
+      Files.push_back(Dir + Line.str());
+  }
+  return true;
+}
+
+/// checkFile - Run PerfEvo over one bitcode file.  Each module gets its own
+/// context so that files can be checked on different threads.
+static void checkFile(const std::string &Filename, SourceCache &Sources,
+                      AnalysisCache *Cache, ModuleReports &Reports) {
+  LLVMContext Context;
+  OwningPtr<MemoryBuffer> Buffer(MemoryBuffer::getFile(Filename,
+                                                       &Reports.Error));
+  if (!Buffer)
+    return;
+
+  OwningPtr<Module> M(ParseBitcodeFile(Buffer.get(), Context,
+                                       &Reports.Error));
+  if (!M) {
+    if (Reports.Error.empty())
+      Reports.Error = "not a valid bitcode file";
+    return;
+  }
+
+  PassManager PM;
+  PM.add(new PerfEvo(Sources, Reports, Cache));
+  PM.run(*M);
+}
+
+static void *runWorker(void *Arg) {
+  BatchQueue &Q = *static_cast<BatchQueue*>(Arg);
+  for (;;) {
+    unsigned i;
+    {
+      sys::SmartScopedLock<false> Guard(Q.Lock);
+      if (Q.Next == Q.Files->size())
+        return 0;
+      i = Q.Next++;
+    }
+    checkFile((*Q.Files)[i], *Q.Sources, Q.Cache, (*Q.Results)[i]);
+  }
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(argc, argv,
+                              "check many bitcode files with PerfEvo\n");
+
+  std::vector<std::string> Files;
+  std::string ErrMsg;
+  if (!readManifest(ManifestFilename, Files, ErrMsg)) {
+    errs() << argv[0] << ": " << ManifestFilename << ": " << ErrMsg << "\n";
+    return 1;
+  }
+
+  std::string ErrorInfo;
+  raw_fd_ostream Out(OutputFilename.c_str(), ErrorInfo);
+  if (!ErrorInfo.empty()) {
+    errs() << argv[0] << ": " << ErrorInfo << "\n";
+    return 1;
+  }
+
+  unsigned Jobs = NumJobs;
+  if (Jobs > Files.size())
+    Jobs = Files.size();
+  if (Jobs > 1 && !llvm_start_multithreaded()) {
+    errs() << argv[0] << ": warning: LLVM was built without thread support, "
+           << "checking one file at a time\n";
+    Jobs = 1;
+  }
+
+  SourceCache Sources;
+  OwningPtr<AnalysisCache> Cache;
+  if (!PerfEvo::getCacheFilename().empty())
+    Cache.reset(new AnalysisCache(PerfEvo::getCacheFilename()));
+
+  std::vector<ModuleReports> Results(Files.size());
+  BatchQueue Q;
+  Q.Files = &Files;
+  Q.Results = &Results;
+  Q.Sources = &Sources;
+  Q.Cache = Cache.get();
+  Q.Next = 0;
+
+  if (Jobs <= 1) {
+    runWorker(&Q);
+  } else {
+    std::vector<pthread_t> Threads(Jobs);
+    for (unsigned i = 0; i != Jobs; ++i)
+      if (pthread_create(&Threads[i], 0, runWorker, &Q) != 0) {
+        errs() << argv[0] << ": cannot create worker thread\n";
+        return 1;
+      }
+    for (unsigned i = 0; i != Jobs; ++i)
+      pthread_join(Threads[i], 0);
+  }
+
+  // Merge in manifest order so the report does not depend on scheduling.
+  int Ret = 0;
+  std::set<std::string> Seen;
+  std::vector<Finding> Ranked;
+  FindingsWriter Writer(Out, PerfEvo::getFindingFormat());
+  for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+    const ModuleReports &R = Results[i];
+    if (!R.Error.empty()) {
+      errs() << argv[0] << ": " << Files[i] << ": " << R.Error << "\n";
+      Ret = 1;
+      continue;
+    }
+    for (unsigned j = 0, je = R.Reports.size(); j != je; ++j)
+      if (Seen.insert(R.Reports[j]).second)
+        Writer.write(R.Reports[j]);
+
+    // A finding in a shared header counts once in the ranking.
+    for (unsigned j = 0, je = R.Ranked.size(); j != je; ++j) {
+      std::string Text;
+      raw_string_ostream OS(Text);
+      PerfEvo::writeFinding(R.Ranked[j], OS);
+      if (Seen.insert(OS.str()).second) {
+        // Each module's findings are in serial order; ties across modules
+        // go in manifest order.
+        Ranked.push_back(R.Ranked[j]);
+        Ranked.back().Order = Ranked.size();
+      }
+    }
+  }
+
+  PerfEvo::sortByWeight(Ranked);
+  for (unsigned i = 0, e = Ranked.size(); i != e; ++i) {
+    std::string Text;
+    raw_string_ostream OS(Text);
+    PerfEvo::writeFinding(Ranked[i], OS);
+    Writer.write(OS.str());
+  }
+  Writer.finish();
+
+  if (Cache && !Cache->save(ErrMsg)) {
+    errs() << argv[0] << ": " << PerfEvo::getCacheFilename() << ": "
+           << ErrMsg << "\n";
+    Ret = 1;
+  }
+  return Ret;
+}
@@ -0,0 +1,404 @@
+//===- perfevo-bench.cpp - Measure how PerfEvo scales ---------------------===//
+//
+// perfevo-bench generates synthetic modules of increasing size and times the
+// function checkers selected with -perfBugID on each of them:
+//
+//   perfevo-bench -perfBugID=all -functions=100,1000,10000 -loops=4 -depth=2
+//
+// Every generated function has -loops loop nests, each -depth loops deep.
+// The innermost body of each nest calls the trigger functions of several
+// checkers with the probability given by the -*-density options: apr_stat
+// with APR_FINFO_MIN, sprintf with a "%02X" format, startTransaction
+// followed by getNdbOperation, and RemoveChildAt.  Instructions carry debug
+// locations into a generated source file, written to -bench-dir, so that
+// checkers that read source lines see realistic input.
+//
+// For each module size and checker, and for all selected checkers run
+// together, the report gives the wall time, the instructions walked per
+// second and the peak resident set size of the process so far.  Loop
+// information is computed by the checker run that needs it and is included
+// in its time.  Checkers run on one thread and without the analysis cache;
+// -perfThreads and -perfCache are refused.
+//
+//===----------------------------------------------------------------------===//
+
+#include "perfevo.h"
+#include "CheckerSet.h"
+#include "SourceCache.h"
+#include "llvm/Constants.h"
+#include "llvm/DerivedTypes.h"
+#include "llvm/Function.h"
+#include "llvm/GlobalVariable.h"
+#include "llvm/Instructions.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Analysis/DebugInfo.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Dwarf.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/IRBuilder.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/System/Signals.h"
+
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/time.h>
+
+using namespace llvm;
+
+static cl::list<unsigned>
+FunctionCounts("functions", cl::CommaSeparated,
+               cl::desc("Module sizes to measure, in functions "
+                        "(default 100,1000,10000)"),
+               cl::value_desc("N,..."));
+
+static cl::opt<unsigned>
+LoopsPerFunction("loops", cl::desc("Loop nests per function"),
+                 cl::value_desc("M"), cl::init(4));
+
+static cl::opt<unsigned>
+NestingDepth("depth", cl::desc("Loops in each loop nest"),
+             cl::value_desc("D"), cl::init(2));
+
+static cl::opt<unsigned>
+AprStatDensity("apr-stat-density",
+               cl::desc("Percent of loop bodies calling apr_stat"),
+               cl::init(10));
+
+static cl::opt<unsigned>
+SprintfDensity("sprintf-density",
+               cl::desc("Percent of loop bodies calling sprintf with %02X"),
+               cl::init(10));
+
+static cl::opt<unsigned>
+NdbDensity("ndb-density",
+           cl::desc("Percent of loop bodies starting an NDB transaction"),
+           cl::init(10));
+
+static cl::opt<unsigned>
+RemoveChildDensity("remove-child-density",
+                   cl::desc("Percent of loop bodies calling RemoveChildAt"),
+                   cl::init(10));
+
+static cl::opt<std::string>
+BenchDir("bench-dir", cl::desc("Directory for the generated source files"),
+         cl::value_desc("directory"), cl::init("."));
+
+namespace {
+/// ModuleGenerator - Fill a module with synthetic functions and keep the
+/// source text their debug locations point to.
+class ModuleGenerator {
+  Module &M;
+  LLVMContext &Ctx;
+  IRBuilder<> B;
+  MDNode *Scope;
+  std::vector<std::string> Lines;
+  unsigned Seed;
+
+  const Type *I32;
+  const Type *I8Ptr;
+  const Type *FinfoTy;
+  const PointerType *NdbPtrTy;
+  Constant *HexFormat;
+  Function *AprStat;
+  Function *Sprintf;
+  Function *StartTransaction;
+  Function *GetNdbOperation;
+  Function *RemoveChildAt;
+
+  Function *declare(StringRef Name, const Type *Ret,
+                    const Type *A0, const Type *A1, bool VarArg = false);
+
+  /// addLine - Append a line to the source file and attribute the
+  /// instructions created next to it.
+  void addLine(const Twine &Text) {
+    Lines.push_back(Text.str());
+    B.SetCurrentDebugLocation(DebugLoc::get(Lines.size(), 1, Scope));
+  }
+
+  /// roll - Return true with the given probability, in percent.  The
+  /// sequence is fixed so every run generates the same module.
+  bool roll(unsigned Percent) {
+    Seed = Seed * 1103515245 + 12345;
+    return (Seed >> 16) % 100 < Percent;
+  }
+
+  void emitTriggers(Value *IV);
+  void emitLoopNest(Function *F, Value *N, unsigned Depth);
+public:
+  ModuleGenerator(Module &M, StringRef Dir, StringRef File);
+
+  /// generate - Add Functions functions, each with Loops loop nests of
+  /// depth Depth.
+  void generate(unsigned Functions, unsigned Loops, unsigned Depth);
+
+  /// writeSource - Write the source text to Path.
+  bool writeSource(const std::string &Path, std::string &ErrorInfo);
+};
+
+/// DiscardReports - Drop the output of module scope checkers.
+class DiscardReports : public ReportCollector {
+public:
+  void addReport(StringRef Func, StringRef Text) {}
+};
+}
+
+ModuleGenerator::ModuleGenerator(Module &Mod, StringRef Dir, StringRef File)
+  : M(Mod), Ctx(Mod.getContext()), B(Mod.getContext()), Seed(1) {
+  DIFactory Factory(M);
+  DICompileUnit CU = Factory.CreateCompileUnit(dwarf::DW_LANG_C_plus_plus,
+                                               File, Dir, "perfevo-bench");
+  Scope = Factory.CreateFile(File, Dir, CU);
+
+  I32 = Type::getInt32Ty(Ctx);
+  I8Ptr = Type::getInt8PtrTy(Ctx);
+
+  // The checkers recognize these by the names of their types.
+  std::vector<const Type*> FinfoFields(16, I32);
+  FinfoTy = StructType::get(Ctx, FinfoFields);
+  M.addTypeName("struct.apr_finfo_t", FinfoTy);
+  std::vector<const Type*> NdbFields(1, Type::getInt64Ty(Ctx));
+  NdbFields.push_back(I8Ptr);
+  const Type *NdbTy = StructType::get(Ctx, NdbFields);
+  M.addTypeName("struct.Ndb", NdbTy);
+  NdbPtrTy = PointerType::getUnqual(NdbTy);
+
+  Constant *Init = ConstantArray::get(Ctx, "%02X%02X");
+  GlobalVariable *GV = new GlobalVariable(M, Init->getType(), true,
+                                          GlobalValue::InternalLinkage,
+                                          Init, ".str");
+  Constant *Zero = ConstantInt::get(I32, 0);
+  Constant *Idx[] = { Zero, Zero };
+  HexFormat = ConstantExpr::getGetElementPtr(GV, Idx, 2);
+
+  const Type *Void = Type::getVoidTy(Ctx);
+  AprStat = declare("apr_stat", I32, PointerType::getUnqual(FinfoTy), I8Ptr);
+  Sprintf = declare("sprintf", I32, I8Ptr, I8Ptr, true);
+  StartTransaction = declare("_ZN3Ndb16startTransactionEPKc", I8Ptr,
+                             NdbPtrTy, I8Ptr);
+  GetNdbOperation = declare("_ZN14NdbTransaction15getNdbOperationEPKc",
+                            I8Ptr, I8Ptr, I8Ptr);
+  RemoveChildAt = declare("_ZN11nsContainer13RemoveChildAtEj", Void,
+                          I8Ptr, I32);
+}
+
+Function *ModuleGenerator::declare(StringRef Name, const Type *Ret,
+                                   const Type *A0, const Type *A1,
+                                   bool VarArg) {
+  std::vector<const Type*> Params;
+  Params.push_back(A0);
+  Params.push_back(A1);
+  // apr_stat takes a flag and a pool besides the file info and path.
+  if (Name == "apr_stat") {
+    Params.push_back(I32);
+    Params.push_back(I8Ptr);
+  }
+  FunctionType *FT = FunctionType::get(Ret, Params, VarArg);
+  return cast<Function>(M.getOrInsertFunction(Name, FT));
+}
+
+void ModuleGenerator::emitTriggers(Value *IV) {
+  Constant *Null = ConstantPointerNull::get(cast<PointerType>(I8Ptr));
+
+  if (roll(AprStatDensity)) {
+    addLine("  apr_stat(&finfo, path, APR_FINFO_MIN, pool);");
+    Value *Finfo = B.CreateAlloca(FinfoTy, 0, "finfo");
+    B.CreateCall4(AprStat, Finfo, Null, ConstantInt::get(I32, 0x0073b170),
+                  Null);
+    addLine("  size += finfo.size;");
+    B.CreateLoad(B.CreateStructGEP(Finfo, 3));
+  }
+
+  if (roll(SprintfDensity)) {
+    addLine("  sprintf(buf, \"%02X%02X\", hi, lo);");
+    B.CreateCall4(Sprintf, Null, HexFormat, IV, IV);
+  }
+
+  if (roll(NdbDensity)) {
+    addLine("  trans = ndb->startTransaction();");
+    Value *Trans = B.CreateCall2(StartTransaction,
+                                 ConstantPointerNull::get(NdbPtrTy), Null);
+    addLine("  op = trans->getNdbOperation(table);");
+    B.CreateCall2(GetNdbOperation, Trans, Null);
+  }
+
+  if (roll(RemoveChildDensity)) {
+    addLine("  container->RemoveChildAt(i);");
+    B.CreateCall2(RemoveChildAt, Null, IV);
+  }
+}
+
+void ModuleGenerator::emitLoopNest(Function *F, Value *N, unsigned Depth) {
+  BasicBlock *Preheader = B.GetInsertBlock();
+  BasicBlock *Header = BasicBlock::Create(Ctx, "loop", F);
+  BasicBlock *Body = BasicBlock::Create(Ctx, "body", F);
+  BasicBlock *Exit = BasicBlock::Create(Ctx, "exit", F);
+
+  addLine("for (int i = 0; i < n; ++i) {");
+  B.CreateBr(Header);
+  B.SetInsertPoint(Header);
+  PHINode *IV = B.CreatePHI(I32, "i");
+  IV->addIncoming(ConstantInt::get(I32, 0), Preheader);
+  B.CreateCondBr(B.CreateICmpSLT(IV, N), Body, Exit);
+
+  B.SetInsertPoint(Body);
+  if (Depth > 1)
+    emitLoopNest(F, N, Depth - 1);
+  else
+    emitTriggers(IV);
+
+  addLine("}");
+  Value *Next = B.CreateAdd(IV, ConstantInt::get(I32, 1));
+  IV->addIncoming(Next, B.GetInsertBlock());
+  B.CreateBr(Header);
+  B.SetInsertPoint(Exit);
+}
+
+void ModuleGenerator::generate(unsigned Functions, unsigned Loops,
+                               unsigned Depth) {
+  std::vector<const Type*> Params(1, I32);
+  FunctionType *FT = FunctionType::get(Type::getVoidTy(Ctx), Params, false);
+
+  for (unsigned f = 0; f != Functions; ++f) {
+    Function *F = Function::Create(FT, GlobalValue::ExternalLinkage,
+                                   "bench_f" + Twine(f), &M);
+    Value *N = F->arg_begin();
+    B.SetInsertPoint(BasicBlock::Create(Ctx, "entry", F));
+    addLine("void bench_f" + Twine(f) + "(int n) {");
+
+    for (unsigned l = 0; l != Loops && Depth; ++l)
+      emitLoopNest(F, N, Depth);
+    if (Depth == 0)
+      for (unsigned l = 0; l != Loops; ++l)
+        emitTriggers(ConstantInt::get(I32, l));
+
+    addLine("}");
+    B.CreateRetVoid();
+  }
+}
+
+bool ModuleGenerator::writeSource(const std::string &Path,
+                                  std::string &ErrorInfo) {
+  raw_fd_ostream Out(Path.c_str(), ErrorInfo);
+  if (!ErrorInfo.empty())
+    return false;
+  for (unsigned i = 0, e = Lines.size(); i != e; ++i)
+    Out << Lines[i] << '\n';
+  return true;
+}
+
+static double getWallSeconds() {
+  struct timeval TV;
+  gettimeofday(&TV, 0);
+  return TV.tv_sec + TV.tv_usec / 1e6;
+}
+
+/// getPeakRSS - Peak resident set size of the process, in kilobytes.
+static long getPeakRSS() {
+  struct rusage RU;
+  if (getrusage(RUSAGE_SELF, &RU) != 0)
+    return 0;
+  return RU.ru_maxrss;
+}
+
+static void printRow(StringRef Checker, unsigned Functions, double Seconds,
+                     unsigned NumInsts) {
+  outs() << Checker;
+  outs().indent(Checker.size() < 24 ? 24 - Checker.size() : 1);
+  outs() << format("%9u", Functions)
+         << format("%12.3f", Seconds * 1000)
+         << format("%14.0f", Seconds > 0 ? NumInsts / Seconds : 0.0)
+         << format("%12ld", getPeakRSS()) << '\n';
+}
+
+/// timeCheckers - Run the checkers in Set over every function of M and
+/// return the wall time taken.
+static double timeCheckers(PerfEvo &Pass, CheckerSet &Set, Module &M) {
+  double Start = getWallSeconds();
+  for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f) {
+    if (f->isDeclaration())
+      continue;
+    std::string Output;
+    Pass.checkFunction(Set, *f, 0, 0, Output);
+  }
+  return getWallSeconds() - Start;
+}
+
+int main(int argc, char **argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;  // Call llvm_shutdown() on exit.
+
+  cl::ParseCommandLineOptions(argc, argv, "measure how PerfEvo scales\n");
+
+  // The checkers are timed one function at a time.  With threads,
+  // doInitialization would already run them all, and with a cache the timed
+  // runs would mostly be cache lookups.
+  if (PerfEvo::getNumThreads() > 1 || !PerfEvo::getCacheFilename().empty()) {
+    errs() << argv[0] << ": -perfThreads and -perfCache cannot be used when "
+           << "benchmarking\n";
+    return 1;
+  }
+
+  std::vector<unsigned> Sizes(FunctionCounts.begin(), FunctionCounts.end());
+  if (Sizes.empty()) {
+    Sizes.push_back(100);
+    Sizes.push_back(1000);
+    Sizes.push_back(10000);
+  }
+
+  std::vector<const CheckerInfo*> Selected;
+  PerfEvo::getSelectedCheckers(Selected);
+
+  outs() << "checker                 functions    wall(ms)     insts/sec"
+         << " peakRSS(KB)\n";
+
+  for (unsigned s = 0, se = Sizes.size(); s != se; ++s) {
+    std::string File = "perfevo-bench-" + utostr(Sizes[s]) + ".cpp";
+    LLVMContext Context;
+    Module M(File, Context);
+    ModuleGenerator Gen(M, BenchDir, File);
+    Gen.generate(Sizes[s], LoopsPerFunction, NestingDepth);
+
+    std::string ErrorInfo;
+    if (!Gen.writeSource(BenchDir + "/" + File, ErrorInfo)) {
+      errs() << argv[0] << ": " << ErrorInfo << "\n";
+      return 1;
+    }
+
+    unsigned NumInsts = 0;
+    for (Module::iterator f = M.begin(), fe = M.end(); f != fe; ++f)
+      for (Function::iterator b = f->begin(), be = f->end(); b != be; ++b)
+        NumInsts += b->size();
+
+    SourceCache Sources;
+    DiscardReports Discard;
+    PerfEvo *Pass = new PerfEvo(Sources, Discard);
+    Pass->doInitialization(M);
+
+    CheckerSet All;
+    for (unsigned i = 0, e = Selected.size(); i != e; ++i) {
+      const CheckerInfo *Info = Selected[i];
+      if (Info->Scope != FunctionScope)
+        continue;
+      All.add(Info);
+
+      CheckerSet One;
+      One.add(Info);
+      printRow(Info->ID, Sizes[s], timeCheckers(*Pass, One, M), NumInsts);
+    }
+    if (All.size() > 1)
+      printRow("(all selected)", Sizes[s], timeCheckers(*Pass, All, M),
+               NumInsts);
+
+    Pass->doFinalization(M);
+    delete Pass;
+  }
+  return 0;
+}